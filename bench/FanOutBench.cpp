@@ -0,0 +1,95 @@
+// Wall time of a fan-out over ThreadPool sizes: an Event set with Set( tp ) releases 256 waiters at
+// once, and WhenAll starts 256 Tasks that each co_await Schedule(). Every Task spins for about
+// 50us, so the time should go down with the thread count up to the number of cores.
+
+#include <Coroutines/Async.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int FAN_OUT = 256;
+constexpr int ROUNDS = 20;
+
+auto Work() -> void {
+    const auto until = clock_type::now() + std::chrono::microseconds { 50 };
+    while( clock_type::now() < until ) {
+    }
+}
+
+auto MakePool( uint32_t threads ) -> ThreadPool::options {
+    ThreadPool::options opts {};
+    opts.thread_count = threads;
+    opts.idle = ThreadPool::idle_policy::park_immediately();
+    return opts;
+}
+
+// Milliseconds per round.
+auto EventFanOut( ThreadPool& tp ) -> double {
+    const auto start = clock_type::now();
+    for( int round = 0; round < ROUNDS; ++round ) {
+        Event event;
+        std::atomic<int> done { 0 };
+        auto waiter = [ & ]() -> Task<void> {
+            co_await event;
+            Work();
+            done.fetch_add( 1, std::memory_order::relaxed );
+        };
+        auto setter = [ & ]() -> Task<void> {
+            co_await tp.Schedule();
+            event.Set( tp );
+        };
+
+        std::vector<Task<void>> waiters;
+        for( int i = 0; i < FAN_OUT; ++i ) {
+            waiters.emplace_back( waiter() );
+        }
+        SyncWait( WhenAll( WhenAll( std::move( waiters ) ), setter() ) );
+    }
+    return std::chrono::duration<double, std::milli>( clock_type::now() - start ).count() / ROUNDS;
+}
+
+auto WhenAllFanOut( ThreadPool& tp ) -> double {
+    const auto start = clock_type::now();
+    for( int round = 0; round < ROUNDS; ++round ) {
+        auto task = [ & ]() -> Task<void> {
+            co_await tp.Schedule();
+            Work();
+        };
+
+        std::vector<Task<void>> tasks;
+        for( int i = 0; i < FAN_OUT; ++i ) {
+            tasks.emplace_back( task() );
+        }
+        SyncWait( WhenAll( std::move( tasks ) ) );
+    }
+    return std::chrono::duration<double, std::milli>( clock_type::now() - start ).count() / ROUNDS;
+}
+
+}
+
+int main() {
+    std::printf( "%u hardware threads, %d Tasks of 50us per round\n", std::thread::hardware_concurrency(), FAN_OUT );
+    std::printf( "threads  Event::Set ms  speedup  WhenAll ms  speedup\n" );
+
+    double eventBase = 0;
+    double whenAllBase = 0;
+    for( uint32_t threads: { 1u, 2u, 4u, 8u, 16u } ) {
+        ThreadPool tp { MakePool( threads ) };
+        const auto event = EventFanOut( tp );
+        const auto whenAll = WhenAllFanOut( tp );
+        if( threads == 1 ) {
+            eventBase = event;
+            whenAllBase = whenAll;
+        }
+        std::printf( "%7u  %13.2f  %7.2f  %10.2f  %7.2f\n", threads, event, eventBase / event, whenAll, whenAllBase / whenAll );
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Submission throughput of the injection queue against the mutex guarded deque ThreadPool used
+// before, with 1 to 16 producers and one consumer draining concurrently. The ring holds every
+// push so none overflows, overflow pushes are the only ones taking a lock. The last part submits
+// through ThreadPool::Schedule from 16 threads outside the pool.
+
+#include <Coroutines/Async.h>
+#include <Coroutines/Private/InjectionQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t PUSHES_PER_PRODUCER = 50000;
+
+auto FakeHandle( std::uintptr_t index ) noexcept -> std::coroutine_handle<> {
+    return std::coroutine_handle<>::from_address( reinterpret_cast<void*>( ( index + 1 ) * 16 ) );
+}
+
+class LockedQueue {
+public:
+    auto Push( std::coroutine_handle<> handle ) -> void {
+        std::scoped_lock lk { this->m_mutex };
+        this->m_handles.emplace_back( handle );
+    }
+
+    auto Pop() -> std::coroutine_handle<> {
+        std::scoped_lock lk { this->m_mutex };
+        if( this->m_handles.empty() ) {
+            return nullptr;
+        }
+        auto handle = this->m_handles.front();
+        this->m_handles.pop_front();
+        return handle;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<std::coroutine_handle<>> m_handles;
+};
+
+// Nanoseconds per push, measured over all producers.
+template<typename TPush, typename TPop>
+auto Run( std::size_t producers, TPush push, TPop pop ) -> double {
+    const auto total = producers * PUSHES_PER_PRODUCER;
+    std::atomic<bool> go { false };
+    std::thread consumer { [ & ] {
+        for( std::size_t popped = 0; popped < total; ) {
+            if( pop() != nullptr ) {
+                ++popped;
+            }
+        }
+    } };
+
+    std::vector<std::thread> threads;
+    for( std::size_t p = 0; p < producers; ++p ) {
+        threads.emplace_back( [ &, p ] {
+            while( !go.load( std::memory_order::acquire ) ) {
+            }
+            for( std::size_t i = 0; i < PUSHES_PER_PRODUCER; ++i ) {
+                push( FakeHandle( p * PUSHES_PER_PRODUCER + i ) );
+            }
+        } );
+    }
+
+    const auto start = clock_type::now();
+    go.store( true, std::memory_order::release );
+    for( auto& thread: threads ) {
+        thread.join();
+    }
+    const auto elapsed = clock_type::now() - start;
+    consumer.join();
+    return static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() ) / static_cast<double>( total );
+}
+
+auto PoolSubmit( std::size_t producers ) -> void {
+    constexpr int TASKS_PER_PRODUCER = 20000;
+
+    ThreadPool::options opts {};
+    opts.thread_count = 4;
+    opts.injection_queue_capacity = producers * TASKS_PER_PRODUCER;
+    ThreadPool tp { std::move( opts ) };
+    std::atomic<int> done { 0 };
+    auto job = [ & ]() -> Task<void> {
+        co_await tp.Schedule();
+        done.fetch_add( 1, std::memory_order::relaxed );
+    };
+
+    const auto start = clock_type::now();
+    std::vector<std::thread> threads;
+    for( std::size_t p = 0; p < producers; ++p ) {
+        threads.emplace_back( [ & ] {
+            std::vector<Task<void>> tasks;
+            tasks.reserve( TASKS_PER_PRODUCER );
+            for( int i = 0; i < TASKS_PER_PRODUCER; ++i ) {
+                tasks.emplace_back( job() );
+            }
+            SyncWait( WhenAll( std::move( tasks ) ) );
+        } );
+    }
+    for( auto& thread: threads ) {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( clock_type::now() - start );
+
+    const auto metrics = tp.Metrics();
+    std::printf( "ThreadPool::Schedule from %zu threads: %d tasks in %lld ms, push contention %llu, overflow pushes %llu\n",
+                 producers,
+                 done.load(),
+                 static_cast<long long>( elapsed.count() ),
+                 static_cast<unsigned long long>( metrics.injection_push_contention ),
+                 static_cast<unsigned long long>( metrics.injection_overflow_pushes ) );
+}
+
+}
+
+int main() {
+    std::printf( "producers  injection queue ns/push  contention  overflow  locked deque ns/push\n" );
+    for( std::size_t producers: { 1, 2, 4, 8, 16 } ) {
+        Coroutines::Private::InjectionQueue queue { 16 * PUSHES_PER_PRODUCER };
+        std::int64_t stamp = 0;
+        const auto lockFree = Run( producers, [ & ]( std::coroutine_handle<> handle ) { queue.Push( handle ); }, [ & ] { return queue.Pop( stamp ); } );
+
+        LockedQueue locked;
+        const auto mutex = Run( producers, [ & ]( std::coroutine_handle<> handle ) { locked.Push( handle ); }, [ & ] { return locked.Pop(); } );
+
+        std::printf( "%9zu  %23.1f  %10llu  %8llu  %20.1f\n",
+                     producers,
+                     lockFree,
+                     static_cast<unsigned long long>( queue.PushContention() ),
+                     static_cast<unsigned long long>( queue.OverflowPushes() ),
+                     mutex );
+    }
+
+    PoolSubmit( 16 );
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Nanoseconds per call of a chain of three Tasks, the innermost failing or not: errors
+// returned as std::unexpected and passed up with Try() against errors thrown and caught by
+// the outermost Task.
+
+#include <Coroutines/Async.h>
+
+#include <chrono>
+#include <cstdio>
+#include <expected>
+#include <stdexcept>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int CALLS = 200000;
+
+enum class error { miss };
+
+auto ExpectedLeaf( int key ) -> Task<std::expected<int, error>> {
+    if( key < 0 ) {
+        co_return std::unexpected( error::miss );
+    }
+    co_return key;
+}
+auto ExpectedMiddle( int key ) -> Task<std::expected<int, error>> {
+    co_return co_await Try( ExpectedLeaf( key ) ) + 1;
+}
+auto ExpectedTop( int key ) -> Task<std::expected<int, error>> {
+    co_return co_await Try( ExpectedMiddle( key ) ) + 1;
+}
+
+auto ThrowingLeaf( int key ) -> Task<int> {
+    if( key < 0 ) {
+        throw std::runtime_error( "miss" );
+    }
+    co_return key;
+}
+auto ThrowingMiddle( int key ) -> Task<int> {
+    co_return co_await ThrowingLeaf( key ) + 1;
+}
+auto ThrowingTop( int key ) -> Task<int> {
+    co_return co_await ThrowingMiddle( key ) + 1;
+}
+
+auto Expected( int key ) -> double {
+    auto run = [ key ]() -> Task<long> {
+        long sum = 0;
+        for( int i = 0; i < CALLS; ++i ) {
+            auto result = co_await ExpectedTop( key );
+            sum += result.value_or( -1 );
+        }
+        co_return sum;
+    };
+
+    const auto start = clock_type::now();
+    SyncWait( run() );
+    return std::chrono::duration<double, std::nano>( clock_type::now() - start ).count() / CALLS;
+}
+
+auto Throwing( int key ) -> double {
+    auto run = [ key ]() -> Task<long> {
+        long sum = 0;
+        for( int i = 0; i < CALLS; ++i ) {
+            try {
+                sum += co_await ThrowingTop( key );
+            } catch( const std::runtime_error& ) {
+                sum -= 1;
+            }
+        }
+        co_return sum;
+    };
+
+    const auto start = clock_type::now();
+    SyncWait( run() );
+    return std::chrono::duration<double, std::nano>( clock_type::now() - start ).count() / CALLS;
+}
+
+}
+
+int main() {
+    std::printf( "%d calls of a chain of three Tasks\n", CALLS );
+    std::printf( "path        success ns  error ns\n" );
+    std::printf( "Try         %10.1f  %8.1f\n", Expected( 1 ), Expected( -1 ) );
+    std::printf( "exceptions  %10.1f  %8.1f\n", Throwing( 1 ), Throwing( -1 ) );
+    return 0;
+}
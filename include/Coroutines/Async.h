@@ -3,13 +3,23 @@
 #include "AsyncMutex.h"
 #include "AsyncSharedMutex.h"
 #include "Event.h"
+#include "FrameAllocator.h"
+#include "FrameArena.h"
 #include "Generator.h"
+#include "Histogram.h"
+#include "IoUringContext.h"
 #include "Latch.h"
+#include "LoopExecutor.h"
+#include "Reactor.h"
 #include "Semaphore.h"
+#include "Strand.h"
 #include "SyncWait.h"
 #include "Task.h"
 #include "TaskContainer.h"
 #include "ThreadPool.h"
+#include "Timeout.h"
+#include "Tracing.h"
+#include "Try.h"
 #include "WhenAll.h"
 
 using namespace Coroutines;
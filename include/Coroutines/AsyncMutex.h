@@ -3,6 +3,7 @@
 #include <atomic>
 #include <coroutine>
 #include <mutex>
+#include <utility>
 
 namespace Coroutines {
 class AsyncMutex;
@@ -41,7 +42,7 @@ private:
 class AsyncMutex {
 public:
     explicit AsyncMutex() noexcept
-        : m_state( const_cast<void*>( UnlockedValue() ) ) {
+        : m_state( state::unlocked ) {
     }
     ~AsyncMutex() = default;
 
@@ -55,18 +56,24 @@ public:
             : m_mutex( m ) {
         }
 
-        auto await_ready() const noexcept -> bool;
+    public:
+        auto await_ready() noexcept -> bool;
         auto await_suspend( std::coroutine_handle<> awaitingCoroutine ) noexcept -> bool;
         auto await_resume() noexcept -> AsyncMutexLock {
             return AsyncMutexLock { this->m_mutex };
         }
+        // Stops waiting without taking the lock, false when an Unlock() already handed it over.
+        auto Abandon() noexcept -> bool;
 
     private:
         friend class AsyncMutex;
 
         AsyncMutex& m_mutex;
         std::coroutine_handle<> m_awaitingCoroutine;
+        LockOperation* m_prev { nullptr };
         LockOperation* m_next { nullptr };
+        bool m_waiting { false };
+        bool m_acquired { false };
     };
 
     [[nodiscard]] auto Lock() -> LockOperation {
@@ -78,12 +85,19 @@ public:
 
 private:
     friend class LockOperation;
-    auto UnlockedValue() const noexcept -> const void* {
-        return &this->m_state;
-    }
 
-    std::atomic<void*> m_state;
-    LockOperation* m_internalWaiters { nullptr };
+    enum class state { unlocked, locked, locked_with_waiters };
+
+    // Caller holds m_waiterMutex.
+    auto PopWaiter() noexcept -> LockOperation*;
+
+    // Locking and unlocking without waiters only touch the state, everything
+    // involving locked_with_waiters happens under m_waiterMutex.
+    std::atomic<state> m_state;
+    std::mutex m_waiterMutex;
+    // Served in arrival order.
+    LockOperation* m_waitersHead { nullptr };
+    LockOperation* m_waitersTail { nullptr };
 };
 
 }
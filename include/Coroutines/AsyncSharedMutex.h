@@ -75,6 +75,7 @@ public:
             , m_exclusive( exclusive ) {
         }
 
+    public:
         auto await_ready() const noexcept -> bool {
             if( this->m_exclusive ) {
                 return this->m_sharedMutex.TryLock();
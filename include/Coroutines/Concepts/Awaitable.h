@@ -15,6 +15,13 @@ concept CAwaiter = requires( T t, std::coroutine_handle<> c ) {
                       { t.await_resume() };
                   };
 
+// A suspended awaiter that can stop waiting: Abandon() unlinks it from whatever it waits on
+// without resuming the coroutine, false when it was already resumed or is being resumed.
+template<typename T>
+concept CAbandonableAwaiter = CAwaiter<T> && requires( T t ) {
+                                                 { t.Abandon() } -> std::same_as<bool>;
+                                             };
+
 template<typename T>
 concept CAwaitable = requires( T t ) {
                         { t.operator co_await() } -> CAwaiter;
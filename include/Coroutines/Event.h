@@ -1,9 +1,12 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <coroutine>
+#include <span>
 
 #include "Concepts/Executor.h"
+#include "Private/CooperativeBudget.h"
 
 
 namespace Coroutines {
@@ -15,8 +18,9 @@ public:
         Awaiter( const Event& e ) noexcept
             : m_event( e ) {
         }
+        // Out of budget, await_suspend() reschedules when the event is set.
         auto await_ready() const noexcept -> bool {
-            return this->m_event.IsSet();
+            return this->m_event.IsSet() && Private::CooperativeBudget::Consume();
         }
         auto await_suspend( std::coroutine_handle<> awaitingCoroutine ) noexcept -> bool;
         auto await_resume() noexcept {
@@ -50,10 +54,28 @@ public:
             }
 
             auto* waiters = static_cast<Awaiter*>( oldValue );
-            while( waiters != nullptr ) {
-                auto* next = waiters->m_next;
-                e.resume( waiters->m_awaitingCoroutine );
-                waiters = next;
+            if constexpr( requires( std::span<std::coroutine_handle<>> handles ) { e.resume( handles ); } ) {
+                // Hand the waiters over in batches so the executor can wake enough threads for all of them.
+                std::array<std::coroutine_handle<>, BATCH_SIZE> batch;
+                std::size_t count = 0;
+                while( waiters != nullptr ) {
+                    auto* next = waiters->m_next;
+                    batch[ count++ ] = waiters->m_awaitingCoroutine;
+                    if( count == batch.size() ) {
+                        e.resume( std::span { batch } );
+                        count = 0;
+                    }
+                    waiters = next;
+                }
+                if( count > 0 ) {
+                    e.resume( std::span { batch.data(), count } );
+                }
+            } else {
+                while( waiters != nullptr ) {
+                    auto* next = waiters->m_next;
+                    e.resume( waiters->m_awaitingCoroutine );
+                    waiters = next;
+                }
             }
         }
     }
@@ -69,6 +91,8 @@ protected:
     mutable std::atomic<void*> m_state;
 
 private:
+    static constexpr std::size_t BATCH_SIZE = 64;
+
     auto Reverse( Awaiter* head ) -> Awaiter*;
 };
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Coroutines {
+
+// Allocator behind Task coroutine frames, enabled with the COROUTINES_FRAME_RECYCLING build
+// option. Frames up to MAX_FRAME_SIZE come from thread local free lists, one per size class,
+// and return to the lists of the thread that allocated them. A frame freed on another thread
+// is collected in a batch handed over to its owner in one go, the owner picks the batches up
+// once its own lists run dry. An exiting thread releases what it cached and leaves its lists
+// to the next thread starting up.
+class FrameAllocator {
+public:
+    static constexpr std::size_t GRANULARITY = 64;
+    static constexpr std::size_t SIZE_CLASSES = 32;
+    // Larger frames, including a 16 byte header, go to the global operator new.
+    static constexpr std::size_t MAX_FRAME_SIZE = GRANULARITY * SIZE_CLASSES;
+    // Frames freed on another thread reach their owner in batches of up to this many.
+    static constexpr std::size_t REMOTE_BATCH_SIZE = 32;
+
+    struct metrics {
+        // Allocated and not freed yet, on any thread.
+        std::uint64_t frames_in_use;
+        // Held in the free lists of all threads, batches on their way to an owner not included.
+        std::uint64_t bytes_cached;
+        // Frames freed on another thread than the one that allocated them.
+        std::uint64_t remote_frees;
+        // Allocations the free lists had nothing for.
+        std::uint64_t misses;
+    };
+
+    static auto Allocate( std::size_t size ) -> void*;
+    static auto Deallocate( void* frame ) noexcept -> void;
+
+    // Bytes a thread keeps in its free lists at most, frames freed past it are released. 1 MiB by default.
+    static auto SetThreadCacheLimit( std::size_t bytes ) noexcept -> void;
+    // Sums the counters of every thread, each may be slightly behind.
+    static auto Metrics() -> metrics;
+};
+
+}
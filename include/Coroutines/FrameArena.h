@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace Coroutines {
+class FrameArena;
+
+namespace Private {
+    class FrameArenaState {
+        friend class Coroutines::FrameArena;
+
+        struct Block;
+
+        // Precedes every frame, keeps the frame at the default new alignment.
+        struct alignas( __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) Header {
+            Block* m_block;
+        };
+
+        struct alignas( __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) Block {
+            auto Data() noexcept -> std::byte* {
+                return reinterpret_cast<std::byte*>( this + 1 );
+            }
+
+            FrameArenaState* m_state;
+            std::size_t m_capacity;
+            // Owner only.
+            std::size_t m_offset { 0 };
+            // Frames allocated less those the owner freed while the block was its current one.
+            std::size_t m_allocated { 0 };
+            // Counts down on every other free, m_allocated is added once the block is retired.
+            // Reaching 0 afterwards means the last frame is gone.
+            std::atomic<std::size_t> m_balance { 0 };
+        };
+
+    public:
+        // The arena of the Task running on this thread, if any.
+        static auto Current() noexcept -> FrameArenaState* {
+            return t_current;
+        }
+        // Returns the arena installed before.
+        static auto Install( FrameArenaState* state ) noexcept -> FrameArenaState* {
+            return std::exchange( t_current, state );
+        }
+
+        // nullptr on other threads than the arena's, once it is gone or for frames larger than a block.
+        auto Allocate( std::size_t size ) -> void* {
+            if( this->m_owner != ThisThread() || this->m_closed ) {
+                return nullptr;
+            }
+
+            const auto total = ( size + sizeof( Header ) + sizeof( Header ) - 1 ) & ~( sizeof( Header ) - 1 );
+            auto* block = this->m_block;
+            if( block == nullptr || block->m_offset + total > block->m_capacity ) [[unlikely]] {
+                block = NextBlock( total );
+                if( block == nullptr ) {
+                    return nullptr;
+                }
+            }
+
+            auto* header = reinterpret_cast<Header*>( block->Data() + block->m_offset );
+            block->m_offset += total;
+            ++block->m_allocated;
+            header->m_block = block;
+            return header + 1;
+        }
+
+        // Any thread.
+        static auto Deallocate( void* frame ) noexcept -> void {
+            auto* block = ( static_cast<Header*>( frame ) - 1 )->m_block;
+            auto* state = block->m_state;
+            if( state->m_owner == ThisThread() && state->m_block == block ) [[likely]] {
+                // An empty block starts over, the next tree gets the memory still in the cache.
+                if( --block->m_allocated == 0 ) {
+                    block->m_offset = 0;
+                }
+                return;
+            }
+            DeallocateRemote( block );
+        }
+
+        // The arena a frame returned by Allocate() came from.
+        static auto Of( const void* frame ) noexcept -> FrameArenaState* {
+            return ( static_cast<const Header*>( frame ) - 1 )->m_block->m_state;
+        }
+
+    private:
+        FrameArenaState( std::size_t blockSize ) noexcept;
+
+        // The address of a thread local, cheaper to compare than std::this_thread::get_id().
+        static auto ThisThread() noexcept -> const void* {
+            return &t_current;
+        }
+
+        static auto DeallocateRemote( Block* block ) noexcept -> void;
+        // Reuses the current block when all its frames are gone, retires it otherwise.
+        auto NextBlock( std::size_t total ) -> Block*;
+        static auto Retire( Block* block ) noexcept -> void;
+        static auto Free( Block* block ) noexcept -> void;
+        auto Close() noexcept -> void;
+        auto Release() noexcept -> void;
+
+        const void* const m_owner;
+        const std::size_t m_blockSize;
+        // Owner only.
+        Block* m_block { nullptr };
+        bool m_closed { false };
+        // The arena plus one per block not freed yet.
+        std::atomic<std::size_t> m_references { 1 };
+
+        static inline thread_local FrameArenaState* t_current { nullptr };
+    };
+}
+
+// Bump allocator for the frames of a tree of short lived Tasks, e.g. those serving one
+// request. Create() calls a coroutine function with the arena current, the Task it returns
+// and every Task created while a Task of the tree runs get their frames from the arena.
+// Frames are carved out of blocks of options::block_size bytes, a block is released in one
+// go once its frames are all gone, or reused when it is the arena's current one.
+//
+// The arena belongs to the thread constructing it and must be destroyed there. Tasks of the
+// tree resumed on other threads, e.g. after awaiting a ThreadPool, get their children's
+// frames from the heap. Frames outliving the arena, e.g. Tasks handed to TaskContainer::Start,
+// keep their block alive until they are destroyed.
+class FrameArena {
+public:
+    struct options {
+        // Frames larger than a block, including a 16 byte header, come from the heap.
+        std::size_t block_size = 16384;
+    };
+
+    explicit FrameArena( options opts = options { .block_size = 16384 } );
+    ~FrameArena();
+
+    FrameArena( const FrameArena& ) = delete;
+    FrameArena( FrameArena&& ) = delete;
+    auto operator=( const FrameArena& ) -> FrameArena& = delete;
+    auto operator=( FrameArena&& ) -> FrameArena& = delete;
+
+    // Calls function( args... ) with the arena current, typically to create the root Task.
+    template<typename TFunction, typename... TArgs>
+    auto Create( TFunction&& function, TArgs&&... args ) -> std::invoke_result_t<TFunction, TArgs...> {
+        struct restore {
+            ~restore() {
+                Private::FrameArenaState::Install( this->m_previous );
+            }
+            Private::FrameArenaState* m_previous;
+        } guard { Private::FrameArenaState::Install( this->m_state ) };
+
+        return std::invoke( std::forward<TFunction>( function ), std::forward<TArgs>( args )... );
+    }
+
+private:
+    Private::FrameArenaState* m_state;
+};
+
+}
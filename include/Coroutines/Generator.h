@@ -4,13 +4,15 @@
 #include <memory>
 #include <type_traits>
 
+#include "Private/AllocatorAwarePromise.h"
+
 namespace Coroutines {
 template<typename T>
 class Generator;
 
 namespace Private {
     template<typename T>
-    class GeneratorPromise {
+    class GeneratorPromise : public AllocatorAwarePromise {
     public:
         using TResult = std::remove_reference_t<T>;
         using TResultRef = std::conditional_t<std::is_reference_v<T>, T, T&>;
@@ -89,7 +91,7 @@ namespace Private {
         }
 
         friend auto operator!=( const GeneratorIterator& it, GeneratorSentinel s ) noexcept -> bool {
-            return it != s;
+            return !( it == s );
         }
 
         friend auto operator==( GeneratorSentinel s, const GeneratorIterator& it ) noexcept -> bool {
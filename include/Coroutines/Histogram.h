@@ -0,0 +1,80 @@
+#pragma once
+
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Coroutines {
+
+namespace Private {
+    class HistogramRecorder;
+}
+
+// Log-linear histogram of durations in the style of HdrHistogram. Every power of two of
+// nanoseconds is split into SUB_BUCKETS linear buckets, a value is known to within 1/16th.
+// Histograms of the same kind can be merged, e.g. the ones of several workers.
+class Histogram {
+    friend class Private::HistogramRecorder;
+
+public:
+    static constexpr std::size_t SUB_BUCKET_BITS = 4;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t { 1 } << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKETS = ( 64 - SUB_BUCKET_BITS + 1 ) * SUB_BUCKETS;
+
+    static constexpr auto BucketOf( std::uint64_t value ) noexcept -> std::size_t {
+        if( value < SUB_BUCKETS ) {
+            return static_cast<std::size_t>( value );
+        }
+
+        const auto shift = static_cast<std::size_t>( std::bit_width( value ) ) - 1 - SUB_BUCKET_BITS;
+        return ( shift + 1 ) * SUB_BUCKETS + static_cast<std::size_t>( ( value >> shift ) & ( SUB_BUCKETS - 1 ) );
+    }
+    static constexpr auto LowestValueOf( std::size_t bucket ) noexcept -> std::uint64_t {
+        if( bucket < SUB_BUCKETS ) {
+            return bucket;
+        }
+
+        const auto shift = bucket / SUB_BUCKETS - 1;
+        return ( SUB_BUCKETS + bucket % SUB_BUCKETS ) << shift;
+    }
+    static constexpr auto HighestValueOf( std::size_t bucket ) noexcept -> std::uint64_t {
+        const auto shift = bucket < SUB_BUCKETS ? 0 : bucket / SUB_BUCKETS - 1;
+        return LowestValueOf( bucket ) + ( ( std::uint64_t { 1 } << shift ) - 1 );
+    }
+
+    auto Record( std::chrono::nanoseconds value, std::uint64_t count = 1 ) -> void;
+    auto Merge( const Histogram& other ) -> void;
+
+    auto Count() const noexcept -> std::uint64_t {
+        return this->m_count;
+    }
+    auto empty() const noexcept -> bool {
+        return this->m_count == 0;
+    }
+    auto Min() const noexcept -> std::chrono::nanoseconds;
+    auto Max() const noexcept -> std::chrono::nanoseconds {
+        return std::chrono::nanoseconds { this->m_max };
+    }
+    auto Mean() const noexcept -> std::chrono::nanoseconds {
+        return std::chrono::nanoseconds { this->m_count == 0 ? 0 : this->m_sum / this->m_count };
+    }
+    // Smallest value at least percentile percent of the recorded values are equivalent to, e.g. 99.9.
+    auto Percentile( double percentile ) const noexcept -> std::chrono::nanoseconds;
+    // Values recorded in the bucket, see BucketOf().
+    auto CountOf( std::size_t bucket ) const noexcept -> std::uint64_t {
+        return bucket < this->m_counts.size() ? this->m_counts[ bucket ] : 0;
+    }
+
+private:
+    auto Add( std::size_t bucket, std::uint64_t count ) -> void;
+
+    // Empty until the first value is recorded.
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_count { 0 };
+    std::uint64_t m_sum { 0 };
+    std::uint64_t m_max { 0 };
+};
+
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <linux/io_uring.h>
+#include <sys/types.h>
+
+#include "Concepts/Awaitable.h"
+#include "Private/InjectionQueue.h"
+#include "Task.h"
+
+namespace Coroutines {
+
+// Executor run by a single thread that also drives an io_uring instance, talking to the
+// kernel through the raw syscalls. Coroutines run on the thread inside RunUntilIdle() /
+// RunUntil(). I/O operations prepared during a round of resumed coroutines go to the kernel
+// with a single io_uring_enter, which also reaps the completions and waits when nothing
+// else is runnable. Operations fail by throwing std::system_error from co_await.
+class IoUringContext {
+public:
+    class Operation {
+        friend class IoUringContext;
+        explicit Operation( IoUringContext& context ) noexcept
+            : m_context( context ) {
+        }
+
+    public:
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
+            this->m_context.resume( awaiting_coroutine );
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+    private:
+        IoUringContext& m_context;
+    };
+
+    // One submission queue entry, the awaiter's address is its user_data so it must not move.
+    class IoOperation {
+        friend class IoUringContext;
+
+    public:
+        IoOperation( const IoOperation& ) = delete;
+        IoOperation( IoOperation&& ) = delete;
+        auto operator=( const IoOperation& ) -> IoOperation& = delete;
+        auto operator=( IoOperation&& ) -> IoOperation& = delete;
+
+        // Operations rejected up front complete without reaching the kernel.
+        auto await_ready() const noexcept -> bool {
+            return this->m_result < 0;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
+            this->m_awaitingCoroutine = awaiting_coroutine;
+            this->m_context.Submit( *this );
+        }
+
+    protected:
+        IoOperation( IoUringContext& context, const char* what, const io_uring_sqe& sqe ) noexcept
+            : m_sqe( sqe )
+            , m_context( context )
+            , m_what( what ) {
+        }
+        // Fails with the negative errno result at co_await.
+        IoOperation( IoUringContext& context, const char* what, std::int32_t result ) noexcept
+            : m_sqe {}
+            , m_context( context )
+            , m_what( what )
+            , m_result( result ) {
+        }
+        ~IoOperation() = default;
+
+        // The completion's result, throws for a negative errno.
+        auto Result() const -> std::int32_t;
+
+        io_uring_sqe m_sqe;
+
+    private:
+        IoUringContext& m_context;
+        const char* m_what;
+        std::coroutine_handle<> m_awaitingCoroutine { nullptr };
+        std::int32_t m_result { 0 };
+        // Links operations submitted from other threads.
+        IoOperation* m_next { nullptr };
+    };
+
+    // Read and Write, co_await yields the number of bytes transferred.
+    class TransferOperation : public IoOperation {
+        friend class IoUringContext;
+        using IoOperation::IoOperation;
+
+    public:
+        auto await_resume() const -> std::size_t {
+            return static_cast<std::size_t>( Result() );
+        }
+    };
+
+    // co_await yields the opened file descriptor, owned by the caller.
+    class OpenOperation : public IoOperation {
+        friend class IoUringContext;
+        using IoOperation::IoOperation;
+
+    public:
+        auto await_resume() const -> int {
+            return Result();
+        }
+    };
+
+    class SyncOperation : public IoOperation {
+        friend class IoUringContext;
+        using IoOperation::IoOperation;
+
+    public:
+        auto await_resume() const -> void {
+            Result();
+        }
+    };
+
+    // Offset meaning the file's current position, required for pipes and sockets.
+    static constexpr std::uint64_t CURRENT_POSITION = ~std::uint64_t { 0 };
+
+    struct options {
+        // Submission queue entries, the kernel rounds up to a power of two.
+        std::uint32_t queue_depth = 256;
+        // Buffers registered with the kernel up front, see ReadFixed() / WriteFixed().
+        std::size_t registered_buffers = 0;
+        std::size_t registered_buffer_size = 0;
+        // Slots in the lock-free inbox for other threads, submissions past it spill into a locked overflow list.
+        std::size_t inbox_capacity = 1024;
+    };
+
+    explicit IoUringContext( options opts = options { .queue_depth = 256, .registered_buffers = 0, .registered_buffer_size = 0, .inbox_capacity = 1024 } );
+    // Cancels the operations still in flight and waits for them, their coroutines are not
+    // resumed. Needs Linux 5.19 to cancel, older kernels wait until they complete on their own.
+    ~IoUringContext();
+
+    IoUringContext( const IoUringContext& ) = delete;
+    IoUringContext( IoUringContext&& ) = delete;
+    auto operator=( const IoUringContext& ) -> IoUringContext& = delete;
+    auto operator=( IoUringContext&& ) -> IoUringContext& = delete;
+
+    [[nodiscard]] auto Schedule() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Queued behind everything else, same as Schedule().
+    [[nodiscard]] auto yield() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Any thread.
+    auto resume( std::coroutine_handle<> handle ) noexcept -> void;
+
+    // The buffers stay valid until the awaiting coroutine resumed. I/O may be awaited from
+    // any thread, the coroutine always resumes on the loop thread.
+    [[nodiscard]] auto Read( int fd, std::span<std::byte> buffer, std::uint64_t offset = CURRENT_POSITION ) noexcept -> TransferOperation;
+    [[nodiscard]] auto Write( int fd, std::span<const std::byte> buffer, std::uint64_t offset = CURRENT_POSITION ) noexcept -> TransferOperation;
+    // length bytes from the start of RegisteredBuffer( index ), the kernel skips pinning the
+    // pages. An index past RegisteredBuffers() fails with EINVAL.
+    [[nodiscard]] auto ReadFixed( int fd, std::size_t index, std::size_t length, std::uint64_t offset = CURRENT_POSITION ) noexcept -> TransferOperation;
+    [[nodiscard]] auto WriteFixed( int fd, std::size_t index, std::size_t length, std::uint64_t offset = CURRENT_POSITION ) noexcept -> TransferOperation;
+    [[nodiscard]] auto Fsync( int fd, bool data_only = false ) noexcept -> SyncOperation;
+    [[nodiscard]] auto Openat( int dir_fd, const char* path, int flags, mode_t mode = 0 ) noexcept -> OpenOperation;
+
+    auto RegisteredBuffer( std::size_t index ) const noexcept -> std::span<std::byte> {
+        return { this->m_buffers.get() + index * this->m_bufferSize, this->m_bufferSize };
+    }
+    auto RegisteredBuffers() const noexcept -> std::size_t {
+        return this->m_bufferCount;
+    }
+
+    // Resumes queued coroutines, and the ones they queue, until nothing is left and no I/O is
+    // in flight, waiting in the kernel for outstanding completions. Returns how many ran.
+    auto RunUntilIdle() -> std::size_t;
+
+    // Runs the loop until a completed, waiting for completions and other threads' resume() while idle.
+    template<Concepts::CAwaitable TAwaitable, typename TResult = std::remove_cvref_t<typename Concepts::CAwaitableTraits<TAwaitable&&>::TAwaiterResult>>
+    auto RunUntil( TAwaitable&& a ) -> TResult {
+        auto task = MakeRunTask<TAwaitable, TResult>( std::forward<TAwaitable>( a ) );
+        resume( task.handle() );
+        while( true ) {
+            RunRound();
+            if( task.is_ready() ) {
+                break;
+            }
+            Enter( this->m_localQueue.empty() );
+        }
+
+        if constexpr( std::is_void_v<TResult> ) {
+            task.promise().result();
+        } else {
+            return TResult( std::move( task ).promise().result() );
+        }
+    }
+
+    // True inside RunUntilIdle() / RunUntil() of this context.
+    auto IsLoopThread() const noexcept -> bool {
+        return s_currentContext == this;
+    }
+
+private:
+    static thread_local IoUringContext* s_currentContext;
+
+    template<typename TAwaitable, typename TResult>
+    static auto MakeRunTask( TAwaitable&& a ) -> Task<TResult> {
+        if constexpr( std::is_void_v<TResult> ) {
+            co_await std::forward<TAwaitable>( a );
+        } else {
+            co_return co_await std::forward<TAwaitable>( a );
+        }
+    }
+
+    // Loop thread: copies the entry into the submission queue, any other thread hands it over.
+    auto Submit( IoOperation& operation ) noexcept -> void;
+    auto Prepare( const io_uring_sqe& sqe ) noexcept -> void;
+    auto ArmWakeup() noexcept -> void;
+    auto Release() noexcept -> void;
+    // Moves the inbox and operations submitted from other threads over to the loop.
+    auto DrainInbox() noexcept -> void;
+    // Resumes what was queued when it started. Returns how many ran.
+    auto RunRound() -> std::size_t;
+    // The single io_uring_enter of a loop iteration: submits, waits for a completion when
+    // asked to and nothing arrived from other threads meanwhile, then reaps.
+    auto Enter( bool wait ) -> void;
+    auto Reap() noexcept -> void;
+    auto Notify() noexcept -> void;
+
+    int m_ringFd { -1 };
+    int m_eventFd { -1 };
+
+    // Kernel shared rings.
+    void* m_sqRing { nullptr };
+    std::size_t m_sqRingSize { 0 };
+    void* m_cqRing { nullptr };
+    std::size_t m_cqRingSize { 0 };
+    io_uring_sqe* m_sqes { nullptr };
+    std::size_t m_sqesSize { 0 };
+    unsigned* m_sqHead { nullptr };
+    unsigned* m_sqTail { nullptr };
+    unsigned* m_sqArray { nullptr };
+    unsigned m_sqMask { 0 };
+    unsigned m_sqEntries { 0 };
+    unsigned* m_cqHead { nullptr };
+    unsigned* m_cqTail { nullptr };
+    io_uring_cqe* m_cqes { nullptr };
+    unsigned m_cqMask { 0 };
+
+    std::unique_ptr<std::byte[]> m_buffers;
+    std::size_t m_bufferCount { 0 };
+    std::size_t m_bufferSize { 0 };
+
+    // Only touched by the thread running the loop.
+    std::deque<std::coroutine_handle<>> m_localQueue;
+    // Entries prepared but not yet handed to the kernel.
+    unsigned m_toSubmit { 0 };
+    // Operations the kernel has not completed yet, the wakeup read excluded.
+    std::size_t m_inFlight { 0 };
+    bool m_wakeupArmed { false };
+    std::uint64_t m_wakeupValue { 0 };
+
+    Private::InjectionQueue m_inbox;
+    // Stack of operations submitted from other threads.
+    std::atomic<IoOperation*> m_remoteOperations { nullptr };
+    // Set while the loop waits in the kernel, submitters only notify then.
+    std::atomic<bool> m_sleeping { false };
+};
+
+}
+
+#endif
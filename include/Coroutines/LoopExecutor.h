@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <type_traits>
+#include <utility>
+
+#ifndef __linux__
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#include "Concepts/Awaitable.h"
+#include "Private/InjectionQueue.h"
+#include "Task.h"
+
+namespace Coroutines {
+
+// Executor run by a single thread, e.g. one per core. Coroutines run on the thread inside
+// RunUntilIdle() / RunUntil(). resume() from that thread appends to a plain queue, from any
+// other thread it goes through a lock-free inbox and wakes the loop through an eventfd.
+class LoopExecutor {
+public:
+    class Operation {
+        friend class LoopExecutor;
+        explicit Operation( LoopExecutor& loop ) noexcept
+            : m_loop( loop ) {
+        }
+
+    public:
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
+            this->m_loop.resume( awaiting_coroutine );
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+    private:
+        LoopExecutor& m_loop;
+    };
+
+    struct options {
+        // Slots in the lock-free inbox for other threads, submissions past it spill into a locked overflow list.
+        std::size_t inbox_capacity = 1024;
+    };
+
+    explicit LoopExecutor( options opts = options { .inbox_capacity = 1024 } );
+    ~LoopExecutor();
+
+    LoopExecutor( const LoopExecutor& ) = delete;
+    LoopExecutor( LoopExecutor&& ) = delete;
+    auto operator=( const LoopExecutor& ) -> LoopExecutor& = delete;
+    auto operator=( LoopExecutor&& ) -> LoopExecutor& = delete;
+
+    [[nodiscard]] auto Schedule() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Queued behind everything else, same as Schedule().
+    [[nodiscard]] auto yield() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Any thread.
+    auto resume( std::coroutine_handle<> handle ) noexcept -> void;
+
+    // Resumes queued coroutines, and the ones they queue, until nothing is left. Returns how many ran.
+    auto RunUntilIdle() -> std::size_t;
+
+    // Runs the loop until a completed, waiting for other threads' resume() while idle.
+    template<Concepts::CAwaitable TAwaitable, typename TResult = std::remove_cvref_t<typename Concepts::CAwaitableTraits<TAwaitable&&>::TAwaiterResult>>
+    auto RunUntil( TAwaitable&& a ) -> TResult {
+        auto task = MakeRunTask<TAwaitable, TResult>( std::forward<TAwaitable>( a ) );
+        resume( task.handle() );
+        while( true ) {
+            RunUntilIdle();
+            if( task.is_ready() ) {
+                break;
+            }
+            Wait();
+        }
+
+        if constexpr( std::is_void_v<TResult> ) {
+            task.promise().result();
+        } else {
+            return TResult( std::move( task ).promise().result() );
+        }
+    }
+
+    // True inside RunUntilIdle() / RunUntil() of this loop.
+    auto IsLoopThread() const noexcept -> bool {
+        return s_currentLoop == this;
+    }
+
+private:
+    static thread_local LoopExecutor* s_currentLoop;
+
+    template<typename TAwaitable, typename TResult>
+    static auto MakeRunTask( TAwaitable&& a ) -> Task<TResult> {
+        if constexpr( std::is_void_v<TResult> ) {
+            co_await std::forward<TAwaitable>( a );
+        } else {
+            co_return co_await std::forward<TAwaitable>( a );
+        }
+    }
+
+    // Moves the inbox over to m_localQueue.
+    auto DrainInbox() noexcept -> void;
+    // Blocks until another thread resumed something.
+    auto Wait() -> void;
+    auto Notify() noexcept -> void;
+
+    // Only touched by the thread running the loop.
+    std::deque<std::coroutine_handle<>> m_localQueue;
+    Private::InjectionQueue m_inbox;
+    // Set while the loop blocks in Wait(), submitters only notify then.
+    std::atomic<bool> m_sleeping { false };
+#ifdef __linux__
+    int m_eventFd { -1 };
+#else
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    bool m_wakeup { false };
+#endif
+};
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "../FrameArena.h"
+
+#ifdef COROUTINES_FRAME_RECYCLING
+#include "../FrameAllocator.h"
+#endif
+
+namespace Coroutines::Private {
+
+// Base of the promise types. A coroutine whose parameters start with std::allocator_arg_t and
+// an allocator, after the object parameter of member functions and lambdas, gets its frame
+// from a copy of that allocator like std::generator. Any other frame comes from the current
+// FrameArena if there is one, else from the FrameAllocator, or the global operator new without
+// COROUTINES_FRAME_RECYCLING. A function pointer stored behind the frame tells operator delete
+// where it came from.
+class AllocatorAwarePromise {
+public:
+    static auto operator new( std::size_t size ) -> void* {
+        if( auto* arena = FrameArenaState::Current() ) {
+            if( void* frame = arena->Allocate( TrailerOffset( size ) + sizeof( deallocate_type ) ) ) {
+                Trailer( frame, size ) = &DeallocateArena;
+                return Allocated( frame, size );
+            }
+        }
+
+#ifdef COROUTINES_FRAME_RECYCLING
+        void* frame = FrameAllocator::Allocate( TrailerOffset( size ) + sizeof( deallocate_type ) );
+#else
+        void* frame = ::operator new( TrailerOffset( size ) + sizeof( deallocate_type ) );
+#endif
+        Trailer( frame, size ) = &DeallocateDefault;
+        return Allocated( frame, size );
+    }
+
+    template<typename TAlloc, typename... TArgs>
+    static auto operator new( std::size_t size, std::allocator_arg_t, const TAlloc& alloc, const TArgs&... ) -> void* {
+        return AllocateWith( size, alloc );
+    }
+
+    template<typename TObject, typename TAlloc, typename... TArgs>
+    static auto operator new( std::size_t size, const TObject&, std::allocator_arg_t, const TAlloc& alloc, const TArgs&... ) -> void* {
+        return AllocateWith( size, alloc );
+    }
+
+    static auto operator delete( void* frame, std::size_t size ) noexcept -> void {
+        Trailer( frame, size )( frame, size );
+    }
+
+protected:
+    // The FrameArena a frame came from according to its trailer, nullptr for other frames.
+    // Only answers for the frame allocated last on this thread, i.e. before its coroutine
+    // first suspends and creates others.
+    static auto ArenaOf( const void* frame ) noexcept -> FrameArenaState* {
+        if( frame != s_lastFrame || Trailer( s_lastFrame, s_lastSize ) != &DeallocateArena ) {
+            return nullptr;
+        }
+        return FrameArenaState::Of( frame );
+    }
+
+private:
+    using deallocate_type = void ( * )( void* frame, std::size_t size ) noexcept;
+
+    // Allocation unit, keeps frames at the default new alignment whatever the allocator's value type.
+    struct alignas( __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) block {
+        std::byte m_bytes[ __STDCPP_DEFAULT_NEW_ALIGNMENT__ ];
+    };
+
+    template<typename TAlloc>
+    using block_allocator = typename std::allocator_traits<TAlloc>::template rebind_alloc<block>;
+
+    static constexpr auto AlignUp( std::size_t offset, std::size_t alignment ) noexcept -> std::size_t {
+        return ( offset + alignment - 1 ) & ~( alignment - 1 );
+    }
+    static constexpr auto TrailerOffset( std::size_t size ) noexcept -> std::size_t {
+        return AlignUp( size, alignof( deallocate_type ) );
+    }
+    template<typename TBlockAlloc>
+    static constexpr auto AllocatorOffset( std::size_t size ) noexcept -> std::size_t {
+        return AlignUp( TrailerOffset( size ) + sizeof( deallocate_type ), alignof( TBlockAlloc ) );
+    }
+    template<typename TBlockAlloc>
+    static constexpr auto Blocks( std::size_t size ) noexcept -> std::size_t {
+        return AlignUp( AllocatorOffset<TBlockAlloc>( size ) + sizeof( TBlockAlloc ), sizeof( block ) ) / sizeof( block );
+    }
+
+    static auto Trailer( void* frame, std::size_t size ) noexcept -> deallocate_type& {
+        return *reinterpret_cast<deallocate_type*>( static_cast<std::byte*>( frame ) + TrailerOffset( size ) );
+    }
+
+    // Remembers where the trailer of the new frame is for ArenaOf().
+    static auto Allocated( void* frame, std::size_t size ) noexcept -> void* {
+        s_lastFrame = frame;
+        s_lastSize = size;
+        return frame;
+    }
+
+    static auto DeallocateDefault( void* frame, std::size_t ) noexcept -> void {
+#ifdef COROUTINES_FRAME_RECYCLING
+        FrameAllocator::Deallocate( frame );
+#else
+        ::operator delete( frame );
+#endif
+    }
+
+    static auto DeallocateArena( void* frame, std::size_t ) noexcept -> void {
+        FrameArenaState::Deallocate( frame );
+    }
+
+    template<typename TAlloc>
+    static auto AllocateWith( std::size_t size, const TAlloc& alloc ) -> void* {
+        using TBlockAlloc = block_allocator<TAlloc>;
+        using traits = std::allocator_traits<TBlockAlloc>;
+
+        TBlockAlloc blockAlloc( alloc );
+        void* frame = std::to_address( traits::allocate( blockAlloc, Blocks<TBlockAlloc>( size ) ) );
+        ::new( static_cast<std::byte*>( frame ) + AllocatorOffset<TBlockAlloc>( size ) ) TBlockAlloc( std::move( blockAlloc ) );
+        Trailer( frame, size ) = &DeallocateWith<TBlockAlloc>;
+        return Allocated( frame, size );
+    }
+
+    template<typename TBlockAlloc>
+    static auto DeallocateWith( void* frame, std::size_t size ) noexcept -> void {
+        using traits = std::allocator_traits<TBlockAlloc>;
+        using pointer = typename traits::pointer;
+
+        // The frame's memory must not hold the allocator while it is given back.
+        auto* stored = std::launder( reinterpret_cast<TBlockAlloc*>( static_cast<std::byte*>( frame ) + AllocatorOffset<TBlockAlloc>( size ) ) );
+        TBlockAlloc blockAlloc( std::move( *stored ) );
+        stored->~TBlockAlloc();
+        traits::deallocate( blockAlloc, std::pointer_traits<pointer>::pointer_to( *static_cast<block*>( frame ) ), Blocks<TBlockAlloc>( size ) );
+    }
+
+    static inline thread_local void* s_lastFrame { nullptr };
+    static inline thread_local std::size_t s_lastSize { 0 };
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+
+namespace Coroutines::Private {
+
+// Operations a coroutine resumed by an executor may complete without giving up the thread,
+// i.e. task continuations and awaits on primitives that are ready right away. Once the
+// budget is used up the coroutine is rescheduled through the executor so everything else
+// queued there gets a turn. Threads without an installed executor have no limit.
+class CooperativeBudget {
+public:
+    using reschedule_type = void ( * )( void* executor, std::coroutine_handle<> handle ) noexcept;
+
+    struct installation {
+        void* m_executor { nullptr };
+        reschedule_type m_reschedule { nullptr };
+    };
+
+    // Called by an executor's threads, nullptr uninstalls. Returns what was installed before.
+    static auto Install( void* executor, reschedule_type reschedule ) noexcept -> installation {
+        return installation { .m_executor = std::exchange( s_executor, executor ), .m_reschedule = std::exchange( s_reschedule, reschedule ) };
+    }
+    static auto Installed() noexcept -> installation {
+        return installation { .m_executor = s_executor, .m_reschedule = s_reschedule };
+    }
+    // Called by the executor before every resume.
+    static auto Refill( std::uint32_t budget ) noexcept -> void {
+        s_remaining = budget;
+    }
+
+    // Takes one operation from the budget, false once it is used up.
+    static auto Consume() noexcept -> bool {
+        if( s_reschedule == nullptr ) {
+            return true;
+        }
+        if( s_remaining == 0 ) [[unlikely]] {
+            return false;
+        }
+        --s_remaining;
+        return true;
+    }
+    static auto Exhausted() noexcept -> bool {
+        return s_reschedule != nullptr && s_remaining == 0;
+    }
+
+    static auto Reschedule( std::coroutine_handle<> handle ) noexcept -> void {
+        s_reschedule( s_executor, handle );
+    }
+    // For an await_suspend() that completed the operation without suspending, charged like a
+    // ready await_ready(): true when the coroutine was rescheduled instead of continuing.
+    static auto YieldIfExhausted( std::coroutine_handle<> handle ) noexcept -> bool {
+        if( Consume() ) [[likely]] {
+            return false;
+        }
+        Reschedule( handle );
+        return true;
+    }
+
+private:
+    static inline thread_local void* s_executor { nullptr };
+    static inline thread_local reschedule_type s_reschedule { nullptr };
+    static inline thread_local std::uint32_t s_remaining { 0 };
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Coroutines::Private {
+
+struct CpuTopology {
+    // Online CPUs of every NUMA node that has any. Without NUMA information
+    // (non-Linux, no sysfs) there is a single node holding every CPU.
+    std::vector<std::vector<uint32_t>> m_nodes;
+    // The first hardware thread of every physical core.
+    std::vector<uint32_t> m_cores;
+
+    static auto Read() -> CpuTopology;
+
+    auto NodeOf( uint32_t cpu ) const noexcept -> std::size_t;
+    auto MaxCpu() const noexcept -> uint32_t;
+};
+
+auto PinCurrentThread( const std::vector<uint32_t>& cpus ) noexcept -> bool;
+// CPU the calling thread runs on, -1 when unknown.
+auto CurrentCpu() noexcept -> int;
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "../Histogram.h"
+#include "OwnerCounter.h"
+
+namespace Coroutines::Private {
+
+// Histogram recorded by a single thread and read by any, see OwnerCounter.
+class HistogramRecorder {
+public:
+    auto Record( std::int64_t ns ) noexcept -> void {
+        const auto value = static_cast<std::uint64_t>( ns < 0 ? 0 : ns );
+        this->m_counts[ Histogram::BucketOf( value ) ].Add();
+        this->m_sum.Add( value );
+        this->m_max.Max( value );
+    }
+
+    // Adds the values recorded so far to histogram.
+    auto MergeInto( Histogram& histogram ) const -> void {
+        for( std::size_t bucket = 0; bucket < Histogram::BUCKETS; ++bucket ) {
+            if( const auto count = this->m_counts[ bucket ].Load(); count != 0 ) {
+                histogram.Add( bucket, count );
+            }
+        }
+        histogram.m_sum += this->m_sum.Load();
+        histogram.m_max = std::max( histogram.m_max, this->m_max.Load() );
+    }
+
+private:
+    std::array<OwnerCounter, Histogram::BUCKETS> m_counts {};
+    OwnerCounter m_sum;
+    OwnerCounter m_max;
+};
+
+}
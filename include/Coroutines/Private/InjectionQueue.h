@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace Coroutines::Private {
+
+// Multi-producer multi-consumer queue of coroutine handles. The fast path is
+// a bounded array of sequenced slots (D. Vyukov), producers and consumers
+// only CAS their own cursor. When the array is full handles spill into a
+// mutex guarded overflow deque so submission never fails. While the deque
+// holds handles later ones queue behind them, and a consumer that emptied
+// the array moves them back in order, so each producer's handles come out in
+// the order it pushed them. Across producers only pushes that do not overlap
+// keep their order: one that checked the deque while it was still empty may
+// land in the array after another producer spilled. Every handle carries an
+// opaque stamp, e.g. its enqueue time.
+class InjectionQueue {
+public:
+    explicit InjectionQueue( std::size_t capacity )
+        : m_mask( RoundUpToPowerOfTwo( capacity ) - 1 )
+        , m_cells( std::make_unique<Cell[]>( m_mask + 1 ) ) {
+        for( std::size_t i = 0; i <= this->m_mask; ++i ) {
+            this->m_cells[ i ].m_sequence.store( i, std::memory_order::relaxed );
+        }
+    }
+    ~InjectionQueue() = default;
+
+    InjectionQueue( const InjectionQueue& ) = delete;
+    InjectionQueue( InjectionQueue&& ) = delete;
+    auto operator=( const InjectionQueue& ) -> InjectionQueue& = delete;
+    auto operator=( InjectionQueue&& ) -> InjectionQueue& = delete;
+
+    auto Push( std::coroutine_handle<> handle, std::int64_t stamp = 0 ) noexcept -> void {
+        if( this->m_overflowSize.load( std::memory_order::acquire ) == 0 && TryPush( handle, stamp ) ) [[likely]] {
+            return;
+        }
+
+        std::scoped_lock lk { this->m_overflowMutex };
+        if( this->m_overflow.empty() && TryPush( handle, stamp ) ) {
+            return;
+        }
+
+        this->m_overflow.emplace_back( handle, stamp );
+        this->m_overflowSize.fetch_add( 1, std::memory_order::release );
+        this->m_overflowPushes.fetch_add( 1, std::memory_order::relaxed );
+    }
+
+    auto Pop( std::int64_t& stamp ) noexcept -> std::coroutine_handle<> {
+        if( auto handle = TryPop( stamp ); handle != nullptr ) [[likely]] {
+            return handle;
+        }
+
+        if( this->m_overflowSize.load( std::memory_order::acquire ) == 0 ) [[likely]] {
+            return nullptr;
+        }
+
+        std::scoped_lock lk { this->m_overflowMutex };
+        if( this->m_overflow.empty() ) {
+            return nullptr;
+        }
+
+        auto [ handle, overflowStamp ] = this->m_overflow.front();
+        stamp = overflowStamp;
+        this->m_overflow.pop_front();
+
+        // Refill the array with the oldest handles, producers keep to the overflow until they are all in.
+        std::size_t moved = 1;
+        while( !this->m_overflow.empty() && TryPush( this->m_overflow.front().first, this->m_overflow.front().second ) ) {
+            this->m_overflow.pop_front();
+            ++moved;
+        }
+        this->m_overflowSize.fetch_sub( moved, std::memory_order::release );
+        return handle;
+    }
+
+    // Approximate, counts slots claimed by producers that are still being filled.
+    auto size() const noexcept -> std::size_t {
+        const auto dequeuePos = this->m_dequeuePos.load( std::memory_order::acquire );
+        const auto enqueuePos = this->m_enqueuePos.load( std::memory_order::acquire );
+        const auto ring = enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+        return ring + this->m_overflowSize.load( std::memory_order::acquire );
+    }
+
+    auto empty() const noexcept -> bool {
+        return size() == 0;
+    }
+
+    // Slot claims producers lost to another producer and had to retry.
+    auto PushContention() const noexcept -> std::uint64_t {
+        return this->m_pushContention.load( std::memory_order::relaxed );
+    }
+
+    // Pushes that found the ring full and went to the overflow list.
+    auto OverflowPushes() const noexcept -> std::uint64_t {
+        return this->m_overflowPushes.load( std::memory_order::relaxed );
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> m_sequence { 0 };
+        std::atomic<void*> m_value { nullptr };
+        std::atomic<std::int64_t> m_stamp { 0 };
+    };
+
+    static auto RoundUpToPowerOfTwo( std::size_t value ) noexcept -> std::size_t {
+        std::size_t result = 2;
+        while( result < value ) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    auto TryPush( std::coroutine_handle<> handle, std::int64_t stamp ) noexcept -> bool {
+        auto pos = this->m_enqueuePos.load( std::memory_order::relaxed );
+        Cell* cell;
+        while( true ) {
+            cell = &this->m_cells[ pos & this->m_mask ];
+            const auto sequence = cell->m_sequence.load( std::memory_order::acquire );
+            const auto diff = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( pos );
+            if( diff == 0 ) {
+                if( this->m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order::relaxed ) ) {
+                    break;
+                }
+            } else if( diff < 0 ) {
+                return false;
+            } else {
+                pos = this->m_enqueuePos.load( std::memory_order::relaxed );
+            }
+            // Only reached when another producer got in between.
+            this->m_pushContention.fetch_add( 1, std::memory_order::relaxed );
+        }
+
+        cell->m_value.store( handle.address(), std::memory_order::relaxed );
+        cell->m_stamp.store( stamp, std::memory_order::relaxed );
+        cell->m_sequence.store( pos + 1, std::memory_order::release );
+        return true;
+    }
+
+    auto TryPop( std::int64_t& stamp ) noexcept -> std::coroutine_handle<> {
+        auto pos = this->m_dequeuePos.load( std::memory_order::relaxed );
+        Cell* cell;
+        while( true ) {
+            cell = &this->m_cells[ pos & this->m_mask ];
+            const auto sequence = cell->m_sequence.load( std::memory_order::acquire );
+            const auto diff = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( pos + 1 );
+            if( diff == 0 ) {
+                if( this->m_dequeuePos.compare_exchange_weak( pos, pos + 1, std::memory_order::relaxed ) ) {
+                    break;
+                }
+            } else if( diff < 0 ) {
+                return nullptr;
+            } else {
+                pos = this->m_dequeuePos.load( std::memory_order::relaxed );
+            }
+        }
+
+        void* address = cell->m_value.load( std::memory_order::relaxed );
+        stamp = cell->m_stamp.load( std::memory_order::relaxed );
+        cell->m_sequence.store( pos + this->m_mask + 1, std::memory_order::release );
+        return std::coroutine_handle<>::from_address( address );
+    }
+
+    const std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    alignas( 64 ) std::atomic<std::size_t> m_enqueuePos { 0 };
+    alignas( 64 ) std::atomic<std::size_t> m_dequeuePos { 0 };
+
+    alignas( 64 ) std::atomic<std::size_t> m_overflowSize { 0 };
+    std::mutex m_overflowMutex;
+    std::deque<std::pair<std::coroutine_handle<>, std::int64_t>> m_overflow;
+
+    alignas( 64 ) std::atomic<std::uint64_t> m_pushContention { 0 };
+    std::atomic<std::uint64_t> m_overflowPushes { 0 };
+};
+
+}
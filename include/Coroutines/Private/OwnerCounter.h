@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Coroutines::Private {
+
+// Statistics counter with a single writing thread, any thread may read it. Updates are a
+// plain load and store without a locked instruction, readers may see a slightly old value.
+class OwnerCounter {
+public:
+    auto Add( std::uint64_t n = 1 ) noexcept -> void {
+        this->m_value.store( this->m_value.load( std::memory_order::relaxed ) + n, std::memory_order::relaxed );
+    }
+
+    auto Max( std::uint64_t value ) noexcept -> void {
+        if( value > this->m_value.load( std::memory_order::relaxed ) ) {
+            this->m_value.store( value, std::memory_order::relaxed );
+        }
+    }
+
+    auto Load() const noexcept -> std::uint64_t {
+        return this->m_value.load( std::memory_order::relaxed );
+    }
+
+private:
+    std::atomic<std::uint64_t> m_value { 0 };
+};
+
+}
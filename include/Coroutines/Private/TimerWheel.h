@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace Coroutines::Private {
+
+// Intrusive entry of a TimerWheel, lives in the object waiting for the deadline.
+struct TimerNode {
+    // Called once the node left the wheel, outside any lock. expired is false when the
+    // timer was cancelled. A returned handle is scheduled by the caller.
+    using fire_type = std::coroutine_handle<> ( * )( TimerNode& node, bool expired ) noexcept;
+
+    std::int64_t m_tick { 0 };
+    fire_type m_fire { nullptr };
+    TimerNode* m_prev { nullptr };
+    TimerNode* m_next { nullptr };
+    std::uint8_t m_level { 0 };
+    std::uint8_t m_slot { 0 };
+    bool m_linked { false };
+};
+
+// Hierarchical timing wheel with millisecond ticks. Six levels of 64 slots cover about
+// two years, later deadlines sit in the last level and are re-inserted until they are
+// due. Insert and Remove are O(1). Not thread safe.
+class TimerWheel {
+public:
+    static constexpr std::int64_t NO_DEADLINE = std::numeric_limits<std::int64_t>::max();
+
+    // Deadlines round up so a timer never fires early, the current time rounds down.
+    static auto DeadlineTick( std::chrono::steady_clock::time_point deadline ) noexcept -> std::int64_t;
+    static auto NowTick() noexcept -> std::int64_t;
+    static auto ToTimePoint( std::int64_t tick ) noexcept -> std::chrono::steady_clock::time_point;
+
+    TimerWheel() noexcept;
+    ~TimerWheel() = default;
+
+    TimerWheel( const TimerWheel& ) = delete;
+    TimerWheel( TimerWheel&& ) = delete;
+    auto operator=( const TimerWheel& ) -> TimerWheel& = delete;
+    auto operator=( TimerWheel&& ) -> TimerWheel& = delete;
+
+    auto Insert( TimerNode& node ) noexcept -> void;
+    // False when the node is not in the wheel, it already fired or is firing.
+    auto Remove( TimerNode& node ) noexcept -> bool;
+    // Unlinks every node due at now, returned as a list chained through m_next.
+    auto Advance( std::int64_t now ) noexcept -> TimerNode*;
+    // Unlinks every node, returned as a list chained through m_next.
+    auto TakeAll() noexcept -> TimerNode*;
+    // Tick at which Advance() has something to do next, a cascade of a higher level
+    // counts. NO_DEADLINE when empty.
+    auto NextDeadline() const noexcept -> std::int64_t;
+
+    auto size() const noexcept -> std::size_t {
+        return this->m_size;
+    }
+    auto empty() const noexcept -> bool {
+        return this->m_size == 0;
+    }
+
+private:
+    static constexpr std::size_t LEVELS = 6;
+    static constexpr std::size_t SLOT_BITS = 6;
+    static constexpr std::size_t SLOTS = std::size_t { 1 } << SLOT_BITS;
+    static constexpr std::int64_t RANGE = std::int64_t { 1 } << ( LEVELS * SLOT_BITS );
+
+    // Next tick Advance() stops at. slot is SLOTS when it only wraps the level around.
+    auto NextExpiration( std::size_t& level, std::size_t& slot ) const noexcept -> std::int64_t;
+    auto Link( TimerNode& node ) noexcept -> void;
+    auto Unlink( TimerNode& node ) noexcept -> void;
+
+    std::int64_t m_current;
+    std::size_t m_size { 0 };
+    // Bit i is set when slot i of the level is not empty.
+    std::array<std::uint64_t, LEVELS> m_occupied {};
+    std::array<std::array<TimerNode*, SLOTS>, LEVELS> m_slots {};
+};
+
+}
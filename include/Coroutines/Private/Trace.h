@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <source_location>
+
+// Tracing hooks, compiled in with COROUTINES_TRACING (CMake option of the same name) and
+// recording once Tracing::Start() was called, see Tracing.h.
+#ifdef COROUTINES_TRACING
+#define COROUTINES_TRACE_CREATE( coroutine, location ) ::Coroutines::Private::TraceLog::Record( ::Coroutines::Private::TraceEventKind::create, ( coroutine ), nullptr, &( location ) )
+#define COROUTINES_TRACE_RESUME_BEGIN( coroutine ) ::Coroutines::Private::TraceLog::Record( ::Coroutines::Private::TraceEventKind::resume_begin, ( coroutine ), nullptr )
+#define COROUTINES_TRACE_RESUME_END( coroutine ) ::Coroutines::Private::TraceLog::Record( ::Coroutines::Private::TraceEventKind::resume_end, ( coroutine ), nullptr )
+#define COROUTINES_TRACE_SUSPEND( coroutine, name ) ::Coroutines::Private::TraceLog::Record( ::Coroutines::Private::TraceEventKind::suspend, ( coroutine ), ( name ) )
+#else
+#define COROUTINES_TRACE_CREATE( coroutine, location ) ( (void)0 )
+#define COROUTINES_TRACE_RESUME_BEGIN( coroutine ) ( (void)0 )
+#define COROUTINES_TRACE_RESUME_END( coroutine ) ( (void)0 )
+#define COROUTINES_TRACE_SUSPEND( coroutine, name ) ( (void)0 )
+#endif
+
+namespace Coroutines::Private {
+
+enum class TraceEventKind : std::uint8_t { create, resume_begin, resume_end, suspend };
+
+struct TraceEvent {
+    std::int64_t m_time { 0 };
+    // Frame address, i.e. std::coroutine_handle<>::address().
+    const void* m_coroutine { nullptr };
+    // String literal naming a suspension point.
+    const char* m_name { nullptr };
+    // Where the coroutine was created, create events only.
+    std::source_location m_location {};
+    TraceEventKind m_kind { TraceEventKind::create };
+};
+
+// Events of one thread, the oldest ones get overwritten once it is full. Only the owning
+// thread writes, readers see every event published through m_written.
+class TraceBuffer {
+public:
+    static constexpr std::size_t CAPACITY = std::size_t { 1 } << 16;
+
+    explicit TraceBuffer( std::uint32_t thread )
+        : m_thread( thread )
+        , m_events( std::make_unique<TraceEvent[]>( CAPACITY ) ) {
+    }
+
+    auto Push( const TraceEvent& event ) noexcept -> void {
+        const auto written = this->m_written.load( std::memory_order::relaxed );
+        this->m_events[ written & ( CAPACITY - 1 ) ] = event;
+        this->m_written.store( written + 1, std::memory_order::release );
+    }
+
+    const std::uint32_t m_thread;
+    std::unique_ptr<TraceEvent[]> m_events;
+    std::atomic<std::uint64_t> m_written { 0 };
+    // Events before it were dropped by Tracing::Clear().
+    std::uint64_t m_cleared { 0 };
+};
+
+class TraceLog {
+public:
+    static auto Enabled() noexcept -> bool {
+        return s_enabled.load( std::memory_order::relaxed );
+    }
+
+    static auto Record( TraceEventKind kind, const void* coroutine, const char* name, const std::source_location* location = nullptr ) noexcept -> void {
+        if( !Enabled() ) [[likely]] {
+            return;
+        }
+
+        auto* buffer = LocalBuffer();
+        if( buffer == nullptr ) {
+            return;
+        }
+
+        buffer->Push( TraceEvent { .m_time = Now(),
+                                   .m_coroutine = coroutine,
+                                   .m_name = name,
+                                   .m_location = location != nullptr ? *location : std::source_location {},
+                                   .m_kind = kind } );
+    }
+
+    static inline std::atomic<bool> s_enabled { false };
+
+private:
+    static auto Now() noexcept -> std::int64_t;
+    // Registers the calling thread's buffer on first use, nullptr when out of memory.
+    static auto LocalBuffer() noexcept -> TraceBuffer*;
+};
+
+}
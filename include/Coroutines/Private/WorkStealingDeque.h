@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+
+namespace Coroutines::Private {
+
+// Bounded Chase-Lev deque. The owning worker pushes and pops at the bottom,
+// any other thread may steal from the top. Push fails when the deque is full,
+// the caller is expected to spill into a shared queue. Every handle carries
+// an opaque stamp, e.g. its enqueue time.
+template<std::size_t CAPACITY>
+class WorkStealingDeque {
+    static_assert( CAPACITY > 0 && ( CAPACITY & ( CAPACITY - 1 ) ) == 0, "CAPACITY must be a power of two" );
+
+public:
+    WorkStealingDeque() noexcept = default;
+    ~WorkStealingDeque() = default;
+
+    WorkStealingDeque( const WorkStealingDeque& ) = delete;
+    WorkStealingDeque( WorkStealingDeque&& ) = delete;
+    auto operator=( const WorkStealingDeque& ) -> WorkStealingDeque& = delete;
+    auto operator=( WorkStealingDeque&& ) -> WorkStealingDeque& = delete;
+
+    // Owner only.
+    auto Push( std::coroutine_handle<> handle, std::int64_t stamp = 0 ) noexcept -> bool {
+        const auto bottom = this->m_bottom.load( std::memory_order::relaxed );
+        const auto top = this->m_top.load( std::memory_order::acquire );
+        if( bottom - top >= static_cast<std::int64_t>( CAPACITY ) ) {
+            return false;
+        }
+
+        auto& slot = this->m_slots[ bottom & MASK ];
+        slot.m_value.store( handle.address(), std::memory_order::relaxed );
+        slot.m_stamp.store( stamp, std::memory_order::relaxed );
+        std::atomic_thread_fence( std::memory_order::release );
+        this->m_bottom.store( bottom + 1, std::memory_order::relaxed );
+        return true;
+    }
+
+    // Owner only.
+    auto Pop( std::int64_t& stamp ) noexcept -> std::coroutine_handle<> {
+        const auto bottom = this->m_bottom.load( std::memory_order::relaxed ) - 1;
+        this->m_bottom.store( bottom, std::memory_order::relaxed );
+        std::atomic_thread_fence( std::memory_order::seq_cst );
+        auto top = this->m_top.load( std::memory_order::relaxed );
+
+        if( top > bottom ) {
+            this->m_bottom.store( bottom + 1, std::memory_order::relaxed );
+            return nullptr;
+        }
+
+        const auto& slot = this->m_slots[ bottom & MASK ];
+        void* address = slot.m_value.load( std::memory_order::relaxed );
+        stamp = slot.m_stamp.load( std::memory_order::relaxed );
+        if( top == bottom ) {
+            // Last element, race against thieves for it.
+            if( !this->m_top.compare_exchange_strong( top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed ) ) {
+                address = nullptr;
+            }
+            this->m_bottom.store( bottom + 1, std::memory_order::relaxed );
+        }
+
+        return std::coroutine_handle<>::from_address( address );
+    }
+
+    // Any thread.
+    auto Steal( std::int64_t& stamp ) noexcept -> std::coroutine_handle<> {
+        auto top = this->m_top.load( std::memory_order::acquire );
+        std::atomic_thread_fence( std::memory_order::seq_cst );
+        const auto bottom = this->m_bottom.load( std::memory_order::acquire );
+
+        if( top >= bottom ) {
+            return nullptr;
+        }
+
+        const auto& slot = this->m_slots[ top & MASK ];
+        void* address = slot.m_value.load( std::memory_order::relaxed );
+        stamp = slot.m_stamp.load( std::memory_order::relaxed );
+        if( !this->m_top.compare_exchange_strong( top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed ) ) {
+            return nullptr;
+        }
+
+        return std::coroutine_handle<>::from_address( address );
+    }
+
+    // Any thread, approximate.
+    auto size() const noexcept -> std::size_t {
+        const auto bottom = this->m_bottom.load( std::memory_order::acquire );
+        const auto top = this->m_top.load( std::memory_order::acquire );
+        return bottom > top ? static_cast<std::size_t>( bottom - top ) : 0;
+    }
+
+    auto empty() const noexcept -> bool {
+        return size() == 0;
+    }
+
+private:
+    static constexpr std::int64_t MASK = static_cast<std::int64_t>( CAPACITY ) - 1;
+
+    struct Slot {
+        std::atomic<void*> m_value { nullptr };
+        std::atomic<std::int64_t> m_stamp { 0 };
+    };
+
+    alignas( 64 ) std::atomic<std::int64_t> m_top { 0 };
+    alignas( 64 ) std::atomic<std::int64_t> m_bottom { 0 };
+    std::array<Slot, CAPACITY> m_slots {};
+};
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Private/InjectionQueue.h"
+#include "ThreadPool.h"
+
+namespace Coroutines {
+
+// Readiness reactor over edge-triggered epoll, run by its own thread. A file descriptor is
+// added once for both directions on its first await and stays until Remove(). co_await
+// Readable( fd ) / Writable( fd ) completes once the fd reported readiness the last await did
+// not consume, the caller then reads or writes until EAGAIN before awaiting again. At most
+// one coroutine waits per fd and direction. Woken coroutines resume on the ThreadPool given
+// to the constructor, one resume( range ) per epoll_wait, or on the reactor thread without one.
+class Reactor {
+    struct Readiness {
+        static constexpr std::uintptr_t READY = 1;
+
+        // 0, READY or the address of the waiting coroutine.
+        std::atomic<std::uintptr_t> m_state { 0 };
+    };
+
+    struct Registration {
+        int m_fd;
+        Readiness m_readable;
+        Readiness m_writable;
+    };
+
+public:
+    class Operation {
+        friend class Reactor;
+        explicit Operation( Reactor& reactor ) noexcept
+            : m_reactor( reactor ) {
+        }
+
+    public:
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
+            this->m_reactor.resume( awaiting_coroutine );
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+    private:
+        Reactor& m_reactor;
+    };
+
+    class ReadinessOperation {
+        friend class Reactor;
+        explicit ReadinessOperation( Readiness& readiness ) noexcept
+            : m_readiness( readiness ) {
+        }
+
+    public:
+        auto await_ready() noexcept -> bool {
+            auto expected = Readiness::READY;
+            return this->m_readiness.m_state.compare_exchange_strong( expected, 0, std::memory_order::acquire, std::memory_order::relaxed );
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
+            std::uintptr_t expected = 0;
+            const auto address = reinterpret_cast<std::uintptr_t>( awaiting_coroutine.address() );
+            if( this->m_readiness.m_state.compare_exchange_strong( expected, address, std::memory_order::acq_rel, std::memory_order::acquire ) ) {
+                return true;
+            }
+
+            // Readiness came in meanwhile, consume it.
+            this->m_readiness.m_state.store( 0, std::memory_order::relaxed );
+            return false;
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+    private:
+        Readiness& m_readiness;
+    };
+
+    struct options {
+        // Events taken per epoll_wait.
+        std::size_t max_events = 128;
+        // Slots in the lock-free inbox for other threads, submissions past it spill into a locked overflow list.
+        std::size_t inbox_capacity = 1024;
+    };
+
+    explicit Reactor( std::shared_ptr<ThreadPool> tp = nullptr, options opts = options { .max_events = 128, .inbox_capacity = 1024 } );
+    // Runs the coroutines resume()d before, and those they resume in turn. Coroutines still
+    // waiting for readiness are not resumed.
+    ~Reactor();
+
+    Reactor( const Reactor& ) = delete;
+    Reactor( Reactor&& ) = delete;
+    auto operator=( const Reactor& ) -> Reactor& = delete;
+    auto operator=( Reactor&& ) -> Reactor& = delete;
+
+    // Runs the coroutine on the reactor thread.
+    [[nodiscard]] auto Schedule() noexcept -> Operation {
+        return Operation { *this };
+    }
+    [[nodiscard]] auto yield() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Any thread.
+    auto resume( std::coroutine_handle<> handle ) noexcept -> void;
+
+    // Errors and hang-ups count as ready for both directions. Throws std::system_error when
+    // epoll refuses the fd, e.g. a regular file.
+    [[nodiscard]] auto Readable( int fd ) -> ReadinessOperation;
+    [[nodiscard]] auto Writable( int fd ) -> ReadinessOperation;
+    // Call before closing the fd, coroutines still waiting on it are woken up.
+    auto Remove( int fd ) -> void;
+
+    auto IsReactorThread() const noexcept -> bool {
+        return this->m_thread.get_id() == std::this_thread::get_id();
+    }
+
+private:
+    auto Register( int fd ) -> Registration&;
+    // Marks the direction ready, returns the coroutine waiting for it if any.
+    static auto Signal( Readiness& readiness ) noexcept -> std::coroutine_handle<>;
+    auto Run( std::stop_token stop_token ) -> void;
+    // Resumes what is in the inbox at this point.
+    auto RunInbox() -> void;
+    auto Notify() noexcept -> void;
+    auto Wake() noexcept -> void;
+
+    std::shared_ptr<ThreadPool> m_threadPool;
+    const options m_opts;
+    int m_epollFd { -1 };
+    int m_eventFd { -1 };
+
+    std::mutex m_registrationsMutex;
+    std::unordered_map<int, std::unique_ptr<Registration>> m_registrations;
+    // Removed while the reactor may still hold events for them, freed before its next epoll_wait.
+    std::vector<std::unique_ptr<Registration>> m_retired;
+
+    Private::InjectionQueue m_inbox;
+    // Set while the reactor blocks in epoll_wait, submitters only notify then.
+    std::atomic<bool> m_sleeping { false };
+
+    std::jthread m_thread;
+};
+
+}
+
+#endif
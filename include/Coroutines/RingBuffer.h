@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Private/CooperativeBudget.h"
+#include "Private/Trace.h"
 #include "StopSignal.h"
 
 #include <array>
@@ -37,37 +39,63 @@ public:
 
         auto await_ready() noexcept -> bool {
             std::unique_lock lk { this->m_rb.m_mutex };
-            return this->m_rb.try_produce_locked( lk, this->m_e );
+            if( !this->m_rb.try_produce_locked( lk, this->m_e ) ) {
+                return false;
+            }
+            // Out of budget, await_suspend() reschedules with the element produced.
+            this->m_completed = true;
+            return Private::CooperativeBudget::Consume();
         }
 
         auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
+            if( this->m_completed ) {
+                Private::CooperativeBudget::Reschedule( awaiting_coroutine );
+                return true;
+            }
+
             std::unique_lock lk { this->m_rb.m_mutex };
             if( this->m_rb.m_stopped.load( std::memory_order::acquire ) ) {
                 this->m_stopped = true;
                 return false;
             }
 
+            if( this->m_rb.try_produce_locked( lk, this->m_e ) ) {
+                if( lk.owns_lock() ) {
+                    lk.unlock();
+                }
+                return Private::CooperativeBudget::YieldIfExhausted( awaiting_coroutine );
+            }
+
             this->m_awaiting_coroutine = awaiting_coroutine;
-            this->m_next = this->m_rb.m_produceWaiters;
-            this->m_rb.m_produceWaiters = this;
+            COROUTINES_TRACE_SUSPEND( awaiting_coroutine.address(), "ring buffer produce wait" );
+            PushWaiter( this->m_rb.m_produceWaiters, this );
             return true;
         }
 
         auto await_resume() -> void {
             if( this->m_stopped ) {
-                throw this->StopSignal {};
+                throw StopSignal {};
             }
         }
 
+        // Stops waiting without producing, false when a consumer already took the element.
+        auto Abandon() noexcept -> bool {
+            std::unique_lock lk { this->m_rb.m_mutex };
+            return UnlinkWaiter( this->m_rb.m_produceWaiters, this );
+        }
+
     private:
         template<typename element_subtype, size_t num_elements_subtype>
         friend class RingBuffer;
 
         RingBuffer<TElement, COUNT>& m_rb;
         std::coroutine_handle<> m_awaiting_coroutine;
+        ProduceOperation* m_prev { nullptr };
         ProduceOperation* m_next { nullptr };
         TElement m_e;
+        bool m_waiting { false };
         bool m_stopped { false };
+        bool m_completed { false };
     };
 
     struct ConsumeOperation {
@@ -77,38 +105,64 @@ public:
 
         auto await_ready() noexcept -> bool {
             std::unique_lock lk { this->m_rb.m_mutex };
-            return this->m_rb.try_consume_locked( lk, this );
+            if( !this->m_rb.try_consume_locked( lk, this ) ) {
+                return false;
+            }
+            // Out of budget, await_suspend() reschedules with the element consumed.
+            this->m_completed = true;
+            return Private::CooperativeBudget::Consume();
         }
 
         auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
+            if( this->m_completed ) {
+                Private::CooperativeBudget::Reschedule( awaiting_coroutine );
+                return true;
+            }
+
             std::unique_lock lk { this->m_rb.m_mutex };
             if( this->m_rb.m_stopped.load( std::memory_order::acquire ) ) {
                 this->m_stopped = true;
                 return false;
             }
+
+            if( this->m_rb.try_consume_locked( lk, this ) ) {
+                if( lk.owns_lock() ) {
+                    lk.unlock();
+                }
+                return Private::CooperativeBudget::YieldIfExhausted( awaiting_coroutine );
+            }
             this->m_awaiting_coroutine = awaiting_coroutine;
-            this->m_next = this->m_rb.m_consumeWaiters;
-            this->m_rb.m_consumeWaiters = this;
+            COROUTINES_TRACE_SUSPEND( awaiting_coroutine.address(), "ring buffer consume wait" );
+            PushWaiter( this->m_rb.m_consumeWaiters, this );
             return true;
         }
 
         auto await_resume() -> TElement {
             if( this->m_stopped ) {
-                throw this->StopSignal {};
+                throw StopSignal {};
             }
 
             return std::move( this->m_e );
         }
 
+        // Stops waiting without consuming, false when a producer already handed over an element.
+        auto Abandon() noexcept -> bool {
+            std::unique_lock lk { this->m_rb.m_mutex };
+            return UnlinkWaiter( this->m_rb.m_consumeWaiters, this );
+        }
+
     private:
         template<typename element_subtype, size_t num_elements_subtype>
         friend class RingBuffer;
 
         RingBuffer<TElement, COUNT>& m_rb;
         std::coroutine_handle<> m_awaiting_coroutine;
+        ConsumeOperation* m_prev { nullptr };
         ConsumeOperation* m_next { nullptr };
         TElement m_e;
+        bool m_waiting { false };
         bool m_stopped { false };
+        bool m_completed { false };
     };
 
     [[nodiscard]] auto Produce( TElement e ) -> ProduceOperation {
@@ -136,9 +190,8 @@ public:
         this->m_stopped.exchange( true, std::memory_order::release );
 
         while( this->m_produceWaiters != nullptr ) {
-            auto* toResume = this->m_produceWaiters;
+            auto* toResume = PopWaiter( this->m_produceWaiters );
             toResume->m_stopped = true;
-            this->m_produceWaiters = this->m_produceWaiters->m_next;
 
             lk.unlock();
             toResume->m_awaiting_coroutine.resume();
@@ -146,9 +199,8 @@ public:
         }
 
         while( this->m_consumeWaiters != nullptr ) {
-            auto* toResume = this->m_consumeWaiters;
+            auto* toResume = PopWaiter( this->m_consumeWaiters );
             toResume->m_stopped = true;
-            this->m_consumeWaiters = this->m_consumeWaiters->m_next;
 
             lk.unlock();
             toResume->m_awaiting_coroutine.resume();
@@ -172,6 +224,47 @@ private:
 
     std::atomic<bool> m_stopped { false };
 
+    // Waiter lists are doubly linked so an abandoned waiter leaves in O(1), callers hold m_mutex.
+    template<typename TOperation>
+    static auto PushWaiter( TOperation*& head, TOperation* op ) noexcept -> void {
+        op->m_prev = nullptr;
+        op->m_next = head;
+        if( head != nullptr ) {
+            head->m_prev = op;
+        }
+        head = op;
+        op->m_waiting = true;
+    }
+
+    template<typename TOperation>
+    static auto PopWaiter( TOperation*& head ) noexcept -> TOperation* {
+        TOperation* op = head;
+        head = op->m_next;
+        if( head != nullptr ) {
+            head->m_prev = nullptr;
+        }
+        op->m_waiting = false;
+        return op;
+    }
+
+    template<typename TOperation>
+    static auto UnlinkWaiter( TOperation*& head, TOperation* op ) noexcept -> bool {
+        if( !op->m_waiting ) {
+            return false;
+        }
+
+        if( op->m_prev != nullptr ) {
+            op->m_prev->m_next = op->m_next;
+        } else {
+            head = op->m_next;
+        }
+        if( op->m_next != nullptr ) {
+            op->m_next->m_prev = op->m_prev;
+        }
+        op->m_waiting = false;
+        return true;
+    }
+
     auto try_produce_locked( std::unique_lock<std::mutex>& lk, TElement& e ) -> bool {
         if( this->m_used == COUNT ) {
             return false;
@@ -182,8 +275,7 @@ private:
         ++this->m_used;
 
         if( this->m_consumeWaiters != nullptr ) {
-            ConsumeOperation* to_resume = this->m_consumeWaiters;
-            this->m_consumeWaiters = this->m_consumeWaiters->m_next;
+            ConsumeOperation* to_resume = PopWaiter( this->m_consumeWaiters );
 
             to_resume->m_e = std::move( this->m_elements[ this->m_back ] );
             this->m_back = ( this->m_back + 1 ) % COUNT;
@@ -206,8 +298,7 @@ private:
         --this->m_used;
 
         if( this->m_produceWaiters != nullptr ) {
-            ProduceOperation* to_resume = this->m_produceWaiters;
-            this->m_produceWaiters = this->m_produceWaiters->m_next;
+            ProduceOperation* to_resume = PopWaiter( this->m_produceWaiters );
 
             this->m_elements[ this->m_front ] = std::move( to_resume->m_e );
             this->m_front = ( this->m_front + 1 ) % COUNT;
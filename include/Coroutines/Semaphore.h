@@ -24,16 +24,21 @@ public:
     public:
         explicit AcquireOperation( Semaphore& s );
 
-        auto await_ready() const noexcept -> bool;
+        auto await_ready() noexcept -> bool;
         auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool;
         auto await_resume() const -> void;
+        // Stops waiting without acquiring, false when a Release() already picked this waiter.
+        auto Abandon() noexcept -> bool;
 
     private:
         friend Semaphore;
 
         Semaphore& m_semaphore;
         std::coroutine_handle<> m_awaiting_coroutine;
+        AcquireOperation* m_prev { nullptr };
         AcquireOperation* m_next { nullptr };
+        bool m_waiting { false };
+        bool m_acquired { false };
     };
 
     auto Release() -> void;
@@ -49,6 +54,9 @@ public:
 private:
     friend class AcquireOperation;
 
+    // Caller holds m_waiterMutex.
+    auto PopWaiter() noexcept -> AcquireOperation*;
+
     const std::ptrdiff_t m_leastMaxValue;
     std::atomic<std::ptrdiff_t> m_counter;
 
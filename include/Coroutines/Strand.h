@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "Concepts/Executor.h"
+#include "Private/CooperativeBudget.h"
+#include "Private/Trace.h"
+#include "Task.h"
+
+namespace Coroutines {
+
+// Serial executor on top of another one. Handles posted to a strand run one at a time and
+// in submission order on the underlying executor, so state only touched from the strand
+// needs no lock: co_await strand.Schedule() takes the place of locking a mutex. Posting
+// is a lock-free push onto an intrusive queue; the first poster of an idle strand hands
+// the strand's drain loop to the executor. Must be idle when destroyed.
+template<Concepts::CExecutor TExecutor>
+class Strand {
+    struct Node {
+        std::atomic<Node*> m_next { nullptr };
+        std::coroutine_handle<> m_handle { nullptr };
+        // Allocated by resume(), deleted once popped.
+        bool m_allocated { false };
+    };
+
+public:
+    class Operation : private Node {
+        friend class Strand;
+        explicit Operation( Strand& strand ) noexcept
+            : m_strand( strand ) {
+        }
+
+    public:
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
+            this->m_handle = awaiting_coroutine;
+            this->m_strand.Post( *this );
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+    private:
+        Strand& m_strand;
+    };
+
+    explicit Strand( std::shared_ptr<TExecutor> e )
+        : m_executor( std::move( e ) )
+        , m_head( &m_stub )
+        , m_tail( &m_stub ) {
+        if( this->m_executor == nullptr ) {
+            throw std::runtime_error { "Strand cannot have a nullptr CExecutor" };
+        }
+        this->m_drainer = Drain();
+    }
+    // Waits for the drain loop to park, it may still be finishing its turn on the executor.
+    ~Strand() {
+        while( this->m_parked.load( std::memory_order::acquire ) != this->m_started.load( std::memory_order::relaxed ) ) {
+            std::this_thread::yield();
+        }
+    }
+
+    Strand( const Strand& ) = delete;
+    Strand( Strand&& ) = delete;
+    auto operator=( const Strand& ) -> Strand& = delete;
+    auto operator=( Strand&& ) -> Strand& = delete;
+
+    [[nodiscard]] auto Schedule() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Queued behind everything already posted to the strand.
+    [[nodiscard]] auto yield() noexcept -> Operation {
+        return Operation { *this };
+    }
+    // Allocates a queue node, Schedule() does not. Running out of memory terminates.
+    auto resume( std::coroutine_handle<> handle ) noexcept -> void {
+        if( handle == nullptr ) {
+            return;
+        }
+
+        auto* node = new Node {};
+        node->m_handle = handle;
+        node->m_allocated = true;
+        Post( *node );
+    }
+
+    // True while the calling thread runs a handle of this strand.
+    auto IsRunningOnStrand() const noexcept -> bool {
+        return this->m_runningThread.load( std::memory_order::relaxed ) == std::this_thread::get_id();
+    }
+
+    auto Executor() const noexcept -> const std::shared_ptr<TExecutor>& {
+        return this->m_executor;
+    }
+
+private:
+    // Handles run per turn on the underlying executor before the strand lets others go first.
+    static constexpr std::size_t BATCH_SIZE = 64;
+
+    // Parks the drain loop once the handles it ran were the last ones, false while more are queued.
+    struct IdleAwaiter {
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> ) noexcept -> bool {
+            auto& strand = this->m_strand;
+            const auto done = this->m_done;
+            if( strand.m_pending.fetch_sub( done, std::memory_order::acq_rel ) != done ) {
+                return false;
+            }
+
+            // A poster may already run the drain loop again, the count is the last thing touched.
+            strand.m_parked.fetch_add( 1, std::memory_order::release );
+            return true;
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+        Strand& m_strand;
+        std::size_t m_done;
+    };
+
+    struct RepostAwaiter {
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> drainer ) noexcept -> void {
+            this->m_strand.m_executor->resume( drainer );
+        }
+        auto await_resume() noexcept -> void {
+        }
+
+        Strand& m_strand;
+    };
+
+    // Continuations cut off by the cooperative budget stay on the strand and run first on its
+    // next turn, ahead of anything posted meanwhile: the handle they belong to never gave it up.
+    // Allocates a queue node like resume(), running out of memory terminates.
+    static auto RescheduleOverBudget( void* strand, std::coroutine_handle<> handle ) noexcept -> void {
+        auto& self = *static_cast<Strand*>( strand );
+        auto* node = new Node {};
+        node->m_handle = handle;
+        node->m_allocated = true;
+        if( self.m_cutOffTail != nullptr ) {
+            self.m_cutOffTail->m_next.store( node, std::memory_order::relaxed );
+        } else {
+            self.m_cutOffHead = node;
+        }
+        self.m_cutOffTail = node;
+        self.m_pending.fetch_add( 1, std::memory_order::relaxed );
+    }
+
+    auto Post( Node& node ) noexcept -> void {
+        Push( node );
+        if( this->m_pending.fetch_add( 1, std::memory_order::acq_rel ) == 0 ) {
+            this->m_started.fetch_add( 1, std::memory_order::relaxed );
+            this->m_executor->resume( this->m_drainer.handle() );
+        }
+    }
+
+    // Intrusive multi-producer single-consumer queue (D. Vyukov), producers only exchange m_tail.
+    auto Push( Node& node ) noexcept -> void {
+        node.m_next.store( nullptr, std::memory_order::relaxed );
+        auto* previous = this->m_tail.exchange( &node, std::memory_order::acq_rel );
+        previous->m_next.store( &node, std::memory_order::release );
+    }
+
+    // Drain loop only, called when m_pending says a node was pushed. Waits out a producer that
+    // swapped m_tail but did not link its node yet.
+    auto Pop() noexcept -> Node* {
+        if( auto* node = this->m_cutOffHead; node != nullptr ) {
+            this->m_cutOffHead = node->m_next.load( std::memory_order::relaxed );
+            if( this->m_cutOffHead == nullptr ) {
+                this->m_cutOffTail = nullptr;
+            }
+            return node;
+        }
+
+        while( true ) {
+            auto* head = this->m_head;
+            auto* next = head->m_next.load( std::memory_order::acquire );
+            if( head == &this->m_stub ) {
+                if( next == nullptr ) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                this->m_head = next;
+                head = next;
+                next = next->m_next.load( std::memory_order::acquire );
+            }
+
+            if( next != nullptr ) {
+                this->m_head = next;
+                return head;
+            }
+
+            if( head == this->m_tail.load( std::memory_order::acquire ) ) {
+                // head is the last node, the stub takes its place so head can be handed out.
+                Push( this->m_stub );
+                next = head->m_next.load( std::memory_order::acquire );
+                if( next != nullptr ) {
+                    this->m_head = next;
+                    return head;
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    auto Drain() -> Task<void> {
+        while( true ) {
+            const auto previous = Private::CooperativeBudget::Installed();
+            if( previous.m_reschedule != nullptr ) {
+                Private::CooperativeBudget::Install( this, &Strand::RescheduleOverBudget );
+            }
+            this->m_runningThread.store( std::this_thread::get_id(), std::memory_order::relaxed );
+
+            // Only handles known to be queued, the count is settled in one go afterwards.
+            const auto available = std::min( this->m_pending.load( std::memory_order::acquire ), BATCH_SIZE );
+            std::size_t done = 0;
+            while( done < available ) {
+                auto* node = Pop();
+                auto handle = node->m_handle;
+                if( node->m_allocated ) {
+                    delete node;
+                }
+
+                ++done;
+                COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+                handle.resume();
+                COROUTINES_TRACE_RESUME_END( handle.address() );
+                if( Private::CooperativeBudget::Exhausted() ) {
+                    break;
+                }
+            }
+
+            const bool turnOver = done == BATCH_SIZE || Private::CooperativeBudget::Exhausted();
+            this->m_runningThread.store( std::thread::id {}, std::memory_order::relaxed );
+            if( previous.m_reschedule != nullptr ) {
+                Private::CooperativeBudget::Install( previous.m_executor, previous.m_reschedule );
+            }
+
+            if( turnOver && this->m_pending.load( std::memory_order::acquire ) != done ) {
+                // Let the executor run something else before the next batch, the count stays above 0.
+                this->m_pending.fetch_sub( done, std::memory_order::acq_rel );
+                co_await RepostAwaiter { *this };
+            } else {
+                co_await IdleAwaiter { *this, done };
+            }
+        }
+    }
+
+    std::shared_ptr<TExecutor> m_executor;
+    Node m_stub;
+    // Consumer side, only touched by the drain loop.
+    Node* m_head;
+    Node* m_cutOffHead { nullptr };
+    Node* m_cutOffTail { nullptr };
+    alignas( 64 ) std::atomic<Node*> m_tail;
+    // Posted handles not yet run, the poster moving it from 0 starts the drain loop.
+    alignas( 64 ) std::atomic<std::size_t> m_pending { 0 };
+    std::atomic<std::thread::id> m_runningThread {};
+    // Drain loop turns started from an idle strand and parked again, equal once it no longer
+    // touches the strand.
+    std::atomic<std::size_t> m_started { 0 };
+    std::atomic<std::size_t> m_parked { 0 };
+    Task<void> m_drainer;
+};
+
+}
@@ -7,6 +7,7 @@
 
 #include "Concepts/Awaitable.h"
 #include "Concepts/Executor.h"
+#include "Private/AllocatorAwarePromise.h"
 #include "Task.h"
 #include "WhenAll.h"
 
@@ -32,7 +33,7 @@ namespace Private {
         bool m_set { false };
     };
 
-    class SyncWaitTaskPromiseBase {
+    class SyncWaitTaskPromiseBase : public AllocatorAwarePromise {
     public:
         SyncWaitTaskPromiseBase() noexcept = default;
         virtual ~SyncWaitTaskPromiseBase() = default;
@@ -194,6 +195,16 @@ namespace Private {
         }
     }
 
+    template<Concepts::CAwaitable TAwaitable, typename TAlloc, typename TResult = typename Concepts::CAwaitableTraits<TAwaitable&&>::TAwaiterResult>
+    static auto MakeSyncWaitTask( std::allocator_arg_t, const TAlloc&, TAwaitable&& a ) -> SyncWaitTask<TResult> {
+        if constexpr( std::is_void_v<TResult> ) {
+            co_await std::forward<TAwaitable>( a );
+            co_return;
+        } else {
+            co_yield co_await std::forward<TAwaitable>( a );
+        }
+    }
+
 }
 
 template<Concepts::CAwaitable TAwaitable>
@@ -206,6 +217,17 @@ auto SyncWait( TAwaitable&& a ) -> decltype( auto ) {
     return task.return_value();
 }
 
+// The frame of the task waiting for a comes from alloc.
+template<typename TAlloc, Concepts::CAwaitable TAwaitable>
+auto SyncWait( std::allocator_arg_t, const TAlloc& alloc, TAwaitable&& a ) -> decltype( auto ) {
+    Private::SyncWaitEvent e {};
+    auto task = Private::MakeSyncWaitTask( std::allocator_arg, alloc, std::forward<TAwaitable>( a ) );
+    task.start( e );
+    e.Wait();
+
+    return task.return_value();
+}
+
 template<Concepts::CAwaitable awaitable_type, Concepts::CExecutor TExecutor>
 void RunAsync( awaitable_type&& awaitable, std::shared_ptr<TExecutor> executor = nullptr ) {
     auto asyncTask = []( auto awaitable, auto executor ) -> Task<void> {
@@ -1,8 +1,18 @@
 #pragma once
 
+#include <concepts>
 #include <coroutine>
+#include <cstddef>
 #include <exception>
+#include <expected>
+#include <source_location>
+#include <type_traits>
 #include <utility>
+#include <variant>
+
+#include "Private/AllocatorAwarePromise.h"
+#include "Private/CooperativeBudget.h"
+#include "Private/Trace.h"
 
 
 namespace Coroutines {
@@ -10,8 +20,24 @@ template<typename return_type = void>
 class Task;
 
 namespace Private {
-    struct PromiseBase {
+    struct PromiseBase : public AllocatorAwarePromise {
         friend class FinalAwaitable;
+        struct InitialAwaitable {
+            auto await_ready() const noexcept -> bool {
+                return false;
+            }
+
+            auto await_suspend( std::coroutine_handle<> coroutine ) noexcept -> void {
+                this->m_promise.AdoptArena( coroutine.address() );
+            }
+
+            auto await_resume() noexcept -> void {
+                this->m_promise.EnterArena();
+            }
+
+            PromiseBase& m_promise;
+        };
+
         struct FinalAwaitable {
             auto await_ready() const noexcept -> bool {
                 return false;
@@ -20,30 +46,76 @@ namespace Private {
             template<typename TPromise>
             auto await_suspend( std::coroutine_handle<TPromise> coroutine ) noexcept -> std::coroutine_handle<> {
                 auto& promise = coroutine.promise();
-                if( promise.m_continuation != nullptr ) {
-                    return promise.m_continuation;
-                } else {
+                promise.LeaveArena();
+                if constexpr( requires { promise.PropagateError(); } ) {
+                    if( auto awaiting = promise.PropagateError() ) {
+                        return awaiting;
+                    }
+                }
+                return Continue( promise );
+            }
+
+            // What runs once the task completed.
+            static auto Continue( PromiseBase& promise ) noexcept -> std::coroutine_handle<> {
+                if( promise.m_continuation == nullptr ) {
                     return std::noop_coroutine();
                 }
+
+                // A chain of tasks completing one another would otherwise never give the thread back.
+                if( !CooperativeBudget::Consume() ) {
+                    CooperativeBudget::Reschedule( promise.m_continuation );
+                    return std::noop_coroutine();
+                }
+                return promise.m_continuation;
             }
 
             auto await_resume() noexcept -> void {
             }
         };
 
+        // Wraps every co_await of the coroutine so its FrameArena is current exactly while it
+        // runs. A pass-through with m_promise nullptr when the frame did not come from an arena.
+        template<typename TAwaiter>
+        struct ArenaAwaitable {
+            auto await_ready() -> decltype( auto ) {
+                return this->m_awaiter.await_ready();
+            }
+
+            template<typename TPromise>
+            auto await_suspend( std::coroutine_handle<TPromise> coroutine ) -> decltype( auto ) {
+                // The coroutine may run elsewhere before the awaiter returns.
+                if( this->m_promise != nullptr ) {
+                    this->m_promise->LeaveArena();
+                }
+                return this->m_awaiter.await_suspend( coroutine );
+            }
+
+            auto await_resume() -> decltype( auto ) {
+                if( this->m_promise != nullptr ) {
+                    this->m_promise->EnterArena();
+                }
+                return this->m_awaiter.await_resume();
+            }
+
+            TAwaiter m_awaiter;
+            PromiseBase* m_promise;
+        };
+
         PromiseBase() noexcept = default;
         ~PromiseBase() = default;
 
-        auto initial_suspend() {
-            return std::suspend_always {};
+        auto initial_suspend() noexcept {
+            return InitialAwaitable { *this };
         }
 
-        auto final_suspend() noexcept( true ) {
-            return FinalAwaitable {};
+        template<typename TAwaitable>
+        auto await_transform( TAwaitable&& awaitable ) {
+            return ArenaAwaitable<decltype( Awaiter( std::forward<TAwaitable>( awaitable ) ) )> { Awaiter( std::forward<TAwaitable>( awaitable ) ),
+                                                                                                 this->m_arena != nullptr ? this : nullptr };
         }
 
-        auto unhandled_exception() -> void {
-            this->m_exception = std::current_exception();
+        auto final_suspend() noexcept( true ) {
+            return FinalAwaitable {};
         }
 
         auto continuation( std::coroutine_handle<> continuation ) noexcept -> void {
@@ -52,49 +124,172 @@ namespace Private {
 
     protected:
         std::coroutine_handle<> m_continuation { nullptr };
-        std::exception_ptr m_exception {};
+
+    private:
+        // The awaitable itself when it is an awaiter already.
+        template<typename TAwaitable>
+        static auto Awaiter( TAwaitable&& awaitable ) -> decltype( auto ) {
+            if constexpr( requires { std::forward<TAwaitable>( awaitable ).operator co_await(); } ) {
+                return std::forward<TAwaitable>( awaitable ).operator co_await();
+            } else if constexpr( requires { operator co_await( std::forward<TAwaitable>( awaitable ) ); } ) {
+                return operator co_await( std::forward<TAwaitable>( awaitable ) );
+            } else {
+                return std::forward<TAwaitable>( awaitable );
+            }
+        }
+
+        // Tasks whose frame came from a FrameArena take it along to their children.
+        auto AdoptArena( const void* frame ) noexcept -> void {
+            this->m_arena = ArenaOf( frame );
+        }
+        // Both do nothing unless the other ran last: awaits that complete without suspending
+        // never left, and GCC may suspend on both operands of co_await a + co_await b before
+        // resuming either.
+        auto EnterArena() noexcept -> void {
+            if( this->m_arena != nullptr && !this->m_entered ) {
+                this->m_outerArena = FrameArenaState::Install( this->m_arena );
+                this->m_entered = true;
+            }
+        }
+        auto LeaveArena() noexcept -> void {
+            if( this->m_entered ) {
+                FrameArenaState::Install( this->m_outerArena );
+                this->m_entered = false;
+            }
+        }
+
+        // Kept alive by the frame's own block.
+        FrameArenaState* m_arena { nullptr };
+        // Whatever was current when the coroutine was resumed.
+        FrameArenaState* m_outerArena { nullptr };
+        bool m_entered { false };
     };
 
     template<typename TResult>
-    struct Promise final : public PromiseBase {
+    struct IsExpected : std::false_type {};
+    template<typename TValue, typename TError>
+    struct IsExpected<std::expected<TValue, TError>> : std::true_type {};
+
+    template<typename TResult>
+    struct ErrorPropagation {
+        constexpr auto IsCompletedEarly() const noexcept -> bool {
+            return false;
+        }
+    };
+
+    // Lets Try() hand an error straight to the Task awaiting this one.
+    template<typename TValue, typename TError>
+    struct ErrorPropagation<std::expected<TValue, TError>> {
+        using propagate_type = std::coroutine_handle<> ( * )( void* awaiting, TError&& error ) noexcept;
+
+        // Completed by an error it awaited through Try(), suspended rather than done.
+        auto IsCompletedEarly() const noexcept -> bool {
+            return this->m_completedEarly;
+        }
+        auto PropagateTo( void* awaiting, propagate_type propagate ) noexcept -> void {
+            this->m_awaiting = awaiting;
+            this->m_propagate = propagate;
+        }
+
+    protected:
+        void* m_awaiting { nullptr };
+        propagate_type m_propagate { nullptr };
+        bool m_completedEarly { false };
+    };
+
+    template<typename TResult>
+    struct Promise final : public PromiseBase, public ErrorPropagation<TResult> {
         using TTask = Task<TResult>;
         using TCoroutineHandle = std::coroutine_handle<Promise<TResult>>;
 
+#ifdef COROUTINES_TRACING
+        // The default argument resolves to the coroutine function.
+        Promise( std::source_location location = std::source_location::current() ) noexcept {
+            COROUTINES_TRACE_CREATE( TCoroutineHandle::from_promise( *this ).address(), location );
+        }
+#else
         Promise() noexcept = default;
+#endif
         ~Promise() = default;
 
         auto get_return_object() noexcept -> TTask;
 
-        auto return_value( TResult value ) -> void {
-            this->m_result = std::move( value );
+        // Constructs the result in place, co_return { ... } included.
+        template<typename TValue = TResult>
+            requires std::constructible_from<TResult, TValue&&>
+        auto return_value( TValue&& value ) noexcept( std::is_nothrow_constructible_v<TResult, TValue&&> ) -> void {
+            this->m_result.template emplace<RESULT>( std::forward<TValue>( value ) );
+        }
+
+        auto unhandled_exception() noexcept -> void {
+            this->m_result.template emplace<EXCEPTION>( std::current_exception() );
         }
 
         auto result() const& -> const TResult& {
-            if( this->m_exception ) {
-                std::rethrow_exception( this->m_exception );
+            if( this->m_result.index() == EXCEPTION ) {
+                std::rethrow_exception( std::get<EXCEPTION>( this->m_result ) );
             }
 
-            return this->m_result;
+            return std::get<RESULT>( this->m_result );
         }
 
         auto result() && -> TResult&& {
-            if( this->m_exception ) {
-                std::rethrow_exception( this->m_exception );
+            if( this->m_result.index() == EXCEPTION ) {
+                std::rethrow_exception( std::get<EXCEPTION>( this->m_result ) );
             }
 
-            return std::move( this->m_result );
+            return std::get<RESULT>( std::move( this->m_result ) );
+        }
+
+        auto Failed() const noexcept -> bool
+            requires IsExpected<TResult>::value
+        {
+            return this->m_result.index() == RESULT && !std::get<RESULT>( this->m_result ).has_value();
+        }
+
+        // Completes the Task with the error without resuming it, returns what runs next.
+        template<typename TOtherError>
+            requires IsExpected<TResult>::value && std::constructible_from<typename TResult::error_type, TOtherError&&>
+        auto CompleteWithError( TOtherError&& error ) noexcept -> std::coroutine_handle<> {
+            this->m_result.template emplace<RESULT>( std::unexpect, std::forward<TOtherError>( error ) );
+            this->m_completedEarly = true;
+            if( auto awaiting = PropagateError() ) {
+                return awaiting;
+            }
+            return FinalAwaitable::Continue( *this );
+        }
+
+        // On an error awaited through Try() the awaiting Task completes in place of being resumed.
+        auto PropagateError() noexcept -> std::coroutine_handle<>
+            requires IsExpected<TResult>::value
+        {
+            if( this->m_propagate == nullptr || !Failed() ) {
+                return nullptr;
+            }
+            return this->m_propagate( this->m_awaiting, std::get<RESULT>( std::move( this->m_result ) ).error() );
         }
 
     private:
-        TResult m_result;
+        // Indices rather than types, TResult may be std::exception_ptr.
+        static constexpr std::size_t RESULT = 1;
+        static constexpr std::size_t EXCEPTION = 2;
+
+        // Empty until the coroutine completes.
+        std::variant<std::monostate, TResult, std::exception_ptr> m_result;
     };
 
     template<>
-    struct Promise<void> : public PromiseBase {
+    struct Promise<void> : public PromiseBase, public ErrorPropagation<void> {
         using TTask = Task<void>;
         using TCoroutineHandle = std::coroutine_handle<Promise<void>>;
 
+#ifdef COROUTINES_TRACING
+        Promise( std::source_location location = std::source_location::current() ) noexcept {
+            COROUTINES_TRACE_CREATE( TCoroutineHandle::from_promise( *this ).address(), location );
+        }
+#else
         Promise() noexcept = default;
+#endif
         ~Promise() = default;
 
         auto get_return_object() noexcept -> TTask;
@@ -102,11 +297,18 @@ namespace Private {
         auto return_void() noexcept -> void {
         }
 
+        auto unhandled_exception() -> void {
+            this->m_exception = std::current_exception();
+        }
+
         auto result() -> void {
             if( m_exception ) {
                 std::rethrow_exception( m_exception );
             }
         }
+
+    private:
+        std::exception_ptr m_exception {};
     };
 
 }
@@ -124,10 +326,11 @@ public:
         }
 
         auto await_ready() const noexcept -> bool {
-            return !this->m_coroutine || this->m_coroutine.done();
+            return !this->m_coroutine || this->m_coroutine.done() || this->m_coroutine.promise().IsCompletedEarly();
         }
 
         auto await_suspend( std::coroutine_handle<> awaitingCoroutine ) noexcept -> std::coroutine_handle<> {
+            COROUTINES_TRACE_SUSPEND( awaitingCoroutine.address(), "await task" );
             this->m_coroutine.promise().continuation( awaitingCoroutine );
             return this->m_coroutine;
         }
@@ -168,14 +371,14 @@ public:
     }
 
     auto is_ready() const noexcept -> bool {
-        return !this->m_coroutine || this->m_coroutine.done();
+        return !this->m_coroutine || this->m_coroutine.done() || this->m_coroutine.promise().IsCompletedEarly();
     }
 
     auto resume() -> bool {
-        if( !this->m_coroutine.done() ) {
+        if( !is_ready() ) {
             this->m_coroutine.resume();
         }
-        return !this->m_coroutine.done();
+        return !is_ready();
     }
 
     auto destroy() -> bool {
@@ -203,19 +406,28 @@ public:
         return awaitable { this->m_coroutine };
     }
 
-    auto operator co_await() const&& noexcept {
+    auto operator co_await() && noexcept {
         struct awaitable : public AwaitableBase {
             auto await_resume() -> decltype( auto ) {
                 if constexpr( std::is_same_v<void, TResult> ) {
                     this->m_coroutine.promise().result();
                     return;
+                } else if constexpr( Private::IsExpected<TResult>::value ) {
+                    // A Task completed early by Try() is suspended at that co_await, its frame
+                    // holds the locals alive there. The result moves out and the frame goes,
+                    // along with those of the Tasks it awaited through Try(), done or not.
+                    TResult result = std::move( this->m_coroutine.promise() ).result();
+                    this->m_task.destroy();
+                    return result;
                 } else {
                     return std::move( this->m_coroutine.promise() ).result();
                 }
             }
+
+            Task& m_task;
         };
 
-        return awaitable { this->m_coroutine };
+        return awaitable { { this->m_coroutine }, *this };
     }
 
     auto promise() & -> promise_type& {
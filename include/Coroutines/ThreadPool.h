@@ -1,20 +1,31 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <coroutine>
-#include <deque>
+#include <exception>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <ranges>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 #include <thread>
 
 #include "Concepts/RangeOf.h"
 #include "Event.h"
+#include "Histogram.h"
+#include "Private/HistogramRecorder.h"
+#include "Private/InjectionQueue.h"
+#include "Private/OwnerCounter.h"
+#include "Private/TimerWheel.h"
+#include "Private/WorkStealingDeque.h"
 #include "Task.h"
 
 #ifdef __clang__
@@ -24,15 +35,19 @@
 
 namespace Coroutines {
 
+// Handles of a higher priority are picked first, a level passed over
+// priority_aging_limit times in a row is served ahead of the higher ones once.
+enum class SchedulePriority { high, normal, low };
+
 class ThreadPool {
 public:
     class Operation {
         friend class ThreadPool;
-        explicit Operation( ThreadPool& tp ) noexcept;
+        explicit Operation( ThreadPool& tp, SchedulePriority priority = SchedulePriority::normal, bool yield = false, bool resumeInline = false ) noexcept;
 
     public:
         auto await_ready() noexcept -> bool {
-            return false;
+            return this->m_inline && this->m_threadPool.TryResumeInline();
         }
         auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void;
         auto await_resume() noexcept -> void {
@@ -41,16 +56,173 @@ public:
     private:
         ThreadPool& m_threadPool;
         std::coroutine_handle<> m_awaitingCoroutine { nullptr };
+        SchedulePriority m_priority { SchedulePriority::normal };
+        bool m_yield { false };
+        bool m_inline { false };
+    };
+
+    // Resumes the awaiting coroutine on the pool once the deadline passed, with millisecond
+    // resolution. co_await yields true when the deadline was reached, false when cancelled.
+    class TimerOperation : private Private::TimerNode {
+        friend class ThreadPool;
+        TimerOperation( ThreadPool& tp, std::chrono::steady_clock::time_point deadline ) noexcept;
+
+    public:
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool;
+        auto await_resume() const noexcept -> bool {
+            return this->m_expired;
+        }
+
+        // Resumes the waiting coroutine right away. Any thread, only while the coroutine
+        // waits, false when the timer already fired.
+        auto Cancel() noexcept -> bool;
+
+    private:
+        static auto Fire( Private::TimerNode& node, bool expired ) noexcept -> std::coroutine_handle<>;
+
+        ThreadPool& m_threadPool;
+        std::chrono::steady_clock::time_point m_deadline;
+        std::coroutine_handle<> m_awaitingCoroutine { nullptr };
+        bool m_expired { true };
+    };
+
+    // What an idle worker does before it parks on the condition variable. Spinning
+    // workers are not counted as sleeping, submitters skip the notify while any
+    // worker is spinning.
+    struct idle_policy {
+        // Queue polls separated by a CPU pause.
+        uint32_t spin_iterations = 64;
+        // Queue polls separated by std::this_thread::yield(), after spinning.
+        uint32_t yield_iterations = 4;
+
+        static constexpr auto park_immediately() noexcept -> idle_policy {
+            return idle_policy { .spin_iterations = 0, .yield_iterations = 0 };
+        }
+        static constexpr auto low_latency() noexcept -> idle_policy {
+            return idle_policy { .spin_iterations = 4096, .yield_iterations = 64 };
+        }
+    };
+
+    // Where workers run. For every mode but none workers are grouped by NUMA node:
+    // each node gets its own injection queue and parking spot, submitters use the
+    // queue of the node they run on and idle workers look at their own node first.
+    enum class thread_affinity {
+        // Not pinned, a single scheduling node.
+        none,
+        // Worker i is pinned to affinity_cpus[ i % affinity_cpus.size() ].
+        cpu_list,
+        // Worker i is pinned to the i-th physical core, wrapping around.
+        one_per_core,
+        // Workers are spread evenly over the NUMA nodes and may run on any CPU of their node.
+        per_numa_node
+    };
+
+    // Grow and shrink with load, thread_count becomes the upper bound. Workers start when
+    // a submission finds nobody idle and the backlog is long enough, and retire once they
+    // were parked for idle_timeout. on_thread_start_functor/on_thread_stop_functor run on
+    // every start and retirement, the index identifies the worker slot.
+    struct elastic_policy {
+        // Workers started up front and never retired.
+        uint32_t min_thread_count = 0;
+        // Queued handles per running worker past which another worker is started.
+        std::size_t spawn_backlog = 1;
+        std::chrono::milliseconds idle_timeout = std::chrono::seconds { 10 };
     };
 
     struct options {
         uint32_t thread_count = std::thread::hardware_concurrency();
         std::function<void( std::size_t )> on_thread_start_functor = nullptr;
         std::function<void( std::size_t )> on_thread_stop_functor = nullptr;
+        // Give every worker its own deque: work scheduled from a worker stays on it,
+        // external submissions go through the shared injection queue and idle
+        // workers steal from each other before parking.
+        bool work_stealing = false;
+        // Slots in the lock-free injection queue, submissions past it spill into a locked overflow list.
+        std::size_t injection_queue_capacity = 4096;
+        // A handle scheduled from a worker goes into that worker's run-next slot and runs
+        // as soon as the current handle returns, the displaced one is queued. yield() and
+        // bulk resume() bypass the slot.
+        bool run_next_slot = false;
+        // Consecutive run-next handles a worker may execute before it serves its queues once.
+        uint32_t run_next_limit = 16;
+        idle_policy idle = idle_policy { .spin_iterations = 64, .yield_iterations = 4 };
+        thread_affinity affinity = thread_affinity::none;
+        std::vector<uint32_t> affinity_cpus = {};
+        // Picks from a higher priority level after which a waiting lower level goes first.
+        uint32_t priority_aging_limit = 64;
+        // Unset, thread_count workers run for the lifetime of the pool.
+        std::optional<elastic_policy> elastic = std::nullopt;
+        // Upper bound for the threads behind ScheduleBlocking(), started on first use.
+        uint32_t blocking_thread_count = 64;
+        // Timestamp every queued handle and record how long it waited to be resumed and how long
+        // resuming took, see Metrics(). Costs two clock reads per handle.
+        bool latency_histograms = false;
+        // Task continuations and ready primitive awaits a resumed handle may run through before
+        // it is queued again behind the other work. Opt-in, 0 disables it. See Private/CooperativeBudget.h.
+        uint32_t cooperative_budget = 0;
     };
 
-    explicit ThreadPool( options opts = options {
-                             .thread_count = std::thread::hardware_concurrency(), .on_thread_start_functor = nullptr, .on_thread_stop_functor = nullptr } );
+    // Counters of one worker slot since the pool started. Workers update their own counters
+    // without shared atomics, a snapshot may be a few updates behind.
+    struct worker_metrics {
+        std::size_t index = 0;
+        // A thread currently runs this worker.
+        bool running = false;
+        // Threads started for the slot, more than one only for an elastic pool.
+        uint64_t starts = 0;
+        uint64_t tasks_executed = 0;
+        // Handles taken from another worker's deque or run-next slot.
+        uint64_t steals = 0;
+        // Idle rounds spent polling before parking, see idle_policy.
+        uint64_t spins = 0;
+        uint64_t parks = 0;
+        // Parks that ended with work to do, the rest timed out or were stopped.
+        uint64_t wakeups = 0;
+        // Parks still in progress are not included.
+        std::chrono::nanoseconds parked_time { 0 };
+        // From finding work after being idle until running out of it again.
+        std::chrono::nanoseconds running_time { 0 };
+        std::size_t local_queue_high_water = 0;
+        // Largest injection queue this worker popped from.
+        std::size_t injection_queue_high_water = 0;
+        // From the handle being queued until it is resumed. Empty without options::latency_histograms.
+        Histogram schedule_latency;
+        // Time spent in resume(), i.e. until the coroutine suspended or finished.
+        Histogram resume_duration;
+    };
+
+    struct metrics {
+        std::vector<worker_metrics> workers;
+        // See size() and queue_size().
+        std::size_t size = 0;
+        std::size_t queue_size = 0;
+        // Times a submitter lost an injection queue slot to another one and retried.
+        uint64_t injection_push_contention = 0;
+        // Submissions that found an injection queue full and took the locked overflow list.
+        uint64_t injection_overflow_pushes = 0;
+        // Merged over all workers.
+        Histogram schedule_latency;
+        Histogram resume_duration;
+    };
+
+    explicit ThreadPool( options opts = options { .thread_count = std::thread::hardware_concurrency(),
+                                                  .on_thread_start_functor = nullptr,
+                                                  .on_thread_stop_functor = nullptr,
+                                                  .work_stealing = false,
+                                                  .injection_queue_capacity = 4096,
+                                                  .run_next_slot = false,
+                                                  .run_next_limit = 16,
+                                                  .idle = idle_policy { .spin_iterations = 64, .yield_iterations = 4 },
+                                                  .affinity = thread_affinity::none,
+                                                  .affinity_cpus = {},
+                                                  .priority_aging_limit = 64,
+                                                  .elastic = std::nullopt,
+                                                  .blocking_thread_count = 64,
+                                                  .latency_histograms = false,
+                                                  .cooperative_budget = 0 } );
 
     ThreadPool( const ThreadPool& ) = delete;
     ThreadPool( ThreadPool&& ) = delete;
@@ -59,10 +231,20 @@ public:
 
     virtual ~ThreadPool();
 
+    // Running workers, changes over time for an elastic pool.
     auto ThreadCount() const noexcept -> uint32_t {
-        return ( uint32_t )m_threads.size();
+        return m_runningWorkers.load( std::memory_order::acquire );
+    }
+    [[nodiscard]] auto Schedule( SchedulePriority priority = SchedulePriority::normal ) -> Operation;
+    // Like Schedule() but does not suspend when the caller already runs on one of this
+    // pool's workers. Use Schedule() or yield() where giving up the thread matters.
+    [[nodiscard]] auto ScheduleInline() -> Operation;
+    [[nodiscard]] auto ScheduleAfter( std::chrono::steady_clock::duration delay ) -> TimerOperation;
+    [[nodiscard]] auto ScheduleAt( std::chrono::steady_clock::time_point deadline ) -> TimerOperation;
+    // True on the threads of this pool.
+    auto IsWorkerThread() const noexcept -> bool {
+        return CurrentWorker() != nullptr;
     }
-    [[nodiscard]] auto Schedule() -> Operation;
     template<typename functor, typename... arguments>
     [[nodiscard]] auto Schedule( functor&& f, arguments... args ) -> Task<decltype( f( std::forward<arguments>( args )... ) )> {
         co_await Schedule();
@@ -74,23 +256,60 @@ public:
             co_return f( std::forward<arguments>( args )... );
         }
     }
+    // Runs f on a separate elastic pool meant for blocking calls and resumes the
+    // awaiting coroutine back on this pool, so workers never stall on it. Task does not
+    // hold references, return a pointer or std::reference_wrapper from f instead.
+    template<typename functor, typename... arguments>
+        requires( !std::is_reference_v<decltype( std::declval<functor&>()( std::declval<arguments>()... ) )> )
+    [[nodiscard]] auto ScheduleBlocking( functor&& f, arguments... args ) -> Task<decltype( f( std::forward<arguments>( args )... ) )> {
+        using return_type = decltype( f( std::forward<arguments>( args )... ) );
+
+        co_await BlockingPool().Schedule();
+
+        std::exception_ptr exception { nullptr };
+        if constexpr( std::is_same_v<void, return_type> ) {
+            try {
+                f( std::forward<arguments>( args )... );
+            } catch( ... ) {
+                exception = std::current_exception();
+            }
+
+            co_await Reenter();
+            if( exception ) {
+                std::rethrow_exception( exception );
+            }
+        } else {
+            std::optional<return_type> result;
+            try {
+                result.emplace( f( std::forward<arguments>( args )... ) );
+            } catch( ... ) {
+                exception = std::current_exception();
+            }
+
+            co_await Reenter();
+            if( exception ) {
+                std::rethrow_exception( exception );
+            }
+            co_return std::move( *result );
+        }
+    }
 
     auto resume( std::coroutine_handle<> handle ) noexcept -> void;
+    auto resume( std::coroutine_handle<> handle, SchedulePriority priority ) noexcept -> void;
 
     template<Coroutines::Concepts::CRangeOf<std::coroutine_handle<>> range_type>
-    auto resume( const range_type& handles ) noexcept -> void {
+    auto resume( const range_type& handles, SchedulePriority priority = SchedulePriority::normal ) noexcept -> void {
         m_size.fetch_add( std::size( handles ), std::memory_order::release );
 
         size_t null_handles { 0 };
 
-        {
-            std::scoped_lock lk { m_waitMutex };
-            for( const auto& handle: handles ) {
-                if( handle != nullptr ) [[likely]] {
-                    m_queue.emplace_back( handle );
-                } else {
-                    ++null_handles;
-                }
+        auto* worker = CurrentWorker();
+        auto& node = SubmitterNode( worker );
+        for( const auto& handle: handles ) {
+            if( handle != nullptr ) [[likely]] {
+                Enqueue( worker, node, handle, priority, false );
+            } else {
+                ++null_handles;
             }
         }
 
@@ -98,12 +317,20 @@ public:
             m_size.fetch_sub( null_handles, std::memory_order::release );
         }
 
-        m_waitCv.notify_one();
+        // One worker per handle so a fan-out runs in parallel right away.
+        if( const auto queued = std::size( handles ) - null_handles; queued > 0 ) {
+            NotifySleepingWorker( node, queued );
+        }
     }
 
-    [[nodiscard]] auto yield() -> Operation {
-        return Schedule();
-    }
+    // Building blocks for timed waits, see TimerOperation and Timeout.h. Timer nodes fire
+    // on a worker, a returned handle is resumed on the pool.
+    // False once the pool shuts down, the node is not inserted then.
+    auto AddTimer( Private::TimerNode& node ) noexcept -> bool;
+    // False when the timer already fired or is firing, otherwise it fires as cancelled.
+    auto CancelTimer( Private::TimerNode& node ) noexcept -> bool;
+
+    [[nodiscard]] auto yield() -> Operation;
     auto shutdown() noexcept -> void;
     auto size() const noexcept -> std::size_t {
         return m_size.load( std::memory_order::acquire );
@@ -112,27 +339,150 @@ public:
         return size() == 0;
     }
     auto queue_size() const noexcept -> std::size_t {
-        std::atomic_thread_fence( std::memory_order::acquire );
-        return m_queue.size();
+        return queue_size( SchedulePriority::high ) + queue_size( SchedulePriority::normal ) + queue_size( SchedulePriority::low );
+    }
+    auto queue_size( SchedulePriority priority ) const noexcept -> std::size_t {
+        std::size_t size = 0;
+        for( const auto& node: m_nodes ) {
+            size += node->m_injectionQueues[ static_cast<std::size_t>( priority ) ].size();
+        }
+        if( priority == SchedulePriority::normal ) {
+            for( const auto& worker: m_workers ) {
+                size += worker->m_localQueue.size();
+                size += worker->m_runNext.load( std::memory_order::relaxed ) != nullptr ? 1 : 0;
+            }
+        }
+        return size;
     }
 
     auto queue_empty() const noexcept -> bool {
         return queue_size() == 0;
     }
+    // Any thread, lock-free.
+    auto Metrics() const -> metrics;
+    auto queue_empty( SchedulePriority priority ) const noexcept -> bool {
+        return queue_size( priority ) == 0;
+    }
 
 private:
-    options m_opts;
-    std::vector<std::jthread> m_threads;
+    static constexpr std::size_t LOCAL_QUEUE_CAPACITY = 256;
+    static constexpr std::size_t PRIORITY_COUNT = 3;
+
+    struct Node {
+        explicit Node( std::size_t injectionQueueCapacity )
+            : m_injectionQueues { Private::InjectionQueue { injectionQueueCapacity }, Private::InjectionQueue { injectionQueueCapacity },
+                                  Private::InjectionQueue { injectionQueueCapacity } } {
+        }
 
-    std::mutex m_waitMutex;
+        // Indexed by SchedulePriority. Worker deques and run-next slots only hold normal priority handles.
+        std::array<Private::InjectionQueue, PRIORITY_COUNT> m_injectionQueues;
+        std::mutex m_waitMutex;
 #ifdef __clang__
-    std::condition_variable_any2 m_waitCv;
+        std::condition_variable_any2 m_waitCv;
 #else
-    std::condition_variable_any m_waitCv;
+        std::condition_variable_any m_waitCv;
 #endif
-    std::deque<std::coroutine_handle<>> m_queue;
+        std::atomic<std::size_t> m_sleepingWorkers { 0 };
+        std::atomic<std::size_t> m_spinningWorkers { 0 };
+        std::size_t m_workerCount { 0 };
+    };
+
+    struct Worker {
+        Worker( ThreadPool& tp, Node& node, std::size_t idx ) noexcept
+            : m_threadPool( tp )
+            , m_node( node )
+            , m_index( idx ) {
+        }
+
+        ThreadPool& m_threadPool;
+        Node& m_node;
+        const std::size_t m_index;
+        // Empty when the worker is not pinned.
+        std::vector<uint32_t> m_cpus;
+        // Every other worker, the ones on the same node first.
+        std::vector<Worker*> m_victims;
+        Private::WorkStealingDeque<LOCAL_QUEUE_CAPACITY> m_localQueue;
+        std::atomic<void*> m_runNext { nullptr };
+        // Only kept with options::latency_histograms, may be off for a handle taken by another worker.
+        std::atomic<std::int64_t> m_runNextStamp { 0 };
+        // Enqueue time of the handle last taken from a queue, 0 when not timestamped.
+        std::int64_t m_stamp { 0 };
+        uint32_t m_runNextStreak { 0 };
+        // Picks since the level was last served, indexed by SchedulePriority.
+        std::array<uint32_t, PRIORITY_COUNT> m_passedOver {};
+        // Set while a thread runs this worker, cleared by the thread as its last step.
+        std::atomic<bool> m_active { false };
+
+        // Written by the thread running the worker only, see Metrics().
+        struct Counters {
+            Private::OwnerCounter m_starts;
+            Private::OwnerCounter m_tasks;
+            Private::OwnerCounter m_steals;
+            Private::OwnerCounter m_spins;
+            Private::OwnerCounter m_parks;
+            Private::OwnerCounter m_wakeups;
+            Private::OwnerCounter m_parkedNs;
+            Private::OwnerCounter m_runningNs;
+            Private::OwnerCounter m_localHighWater;
+            Private::OwnerCounter m_injectionHighWater;
+        };
+        alignas( 64 ) Counters m_counters;
+        // Only allocated with options::latency_histograms.
+        std::unique_ptr<Private::HistogramRecorder> m_scheduleLatency;
+        std::unique_ptr<Private::HistogramRecorder> m_resumeDuration;
+    };
+
+    static thread_local Worker* s_currentWorker;
+
+    options m_opts;
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    // Node used by submitters that are not workers, indexed by CPU.
+    std::vector<std::size_t> m_cpuToNode;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    // One per worker, not joinable until the worker is started.
+    std::vector<std::jthread> m_threads;
+    std::mutex m_spawnMutex;
+    // Set by shutdown() under m_spawnMutex once the workers were asked to stop.
+    bool m_stopping { false };
+    std::atomic<uint32_t> m_runningWorkers { 0 };
+    std::mutex m_timerMutex;
+    Private::TimerWheel m_timers;
+    // m_timers.NextDeadline(), readable without the lock.
+    std::atomic<std::int64_t> m_nextDeadline { Private::TimerWheel::NO_DEADLINE };
+    // Node of the worker parked until m_nextDeadline, other parked workers wait without a timeout.
+    std::atomic<Node*> m_timekeeper { nullptr };
+    std::mutex m_blockingPoolMutex;
+    std::unique_ptr<ThreadPool> m_blockingPool;
+
     auto Executor( std::stop_token stop_token, std::size_t idx ) -> void;
-    auto ScheduleImpl( std::coroutine_handle<> handle ) noexcept -> void;
+    auto ScheduleImpl( std::coroutine_handle<> handle, SchedulePriority priority = SchedulePriority::normal, bool yield = false ) noexcept -> void;
+    auto CurrentWorker() const noexcept -> Worker* {
+        auto* worker = s_currentWorker;
+        return worker != nullptr && &worker->m_threadPool == this ? worker : nullptr;
+    }
+    auto TryResumeInline() noexcept -> bool;
+    static auto RescheduleOverBudget( void* threadPool, std::coroutine_handle<> handle ) noexcept -> void;
+    auto BlockingPool() -> ThreadPool&;
+    // Schedule() that still accepts coroutines coming back from the blocking pool during shutdown.
+    auto Reenter() noexcept -> Operation;
+    auto SubmitterNode( Worker* worker ) const noexcept -> Node&;
+    auto Enqueue( Worker* worker, Node& node, std::coroutine_handle<> handle, SchedulePriority priority, bool runNext ) noexcept -> void;
+    // The stamp of the taken handle goes to thief.m_stamp.
+    auto TakeRunNext( Worker& worker, Worker& thief ) noexcept -> std::coroutine_handle<>;
+    // Wakes up to count workers, the ones parked on the preferred node first.
+    auto NotifySleepingWorker( Node& preferred, std::size_t count = 1 ) noexcept -> void;
+    auto NextHandle( Worker& worker ) noexcept -> std::coroutine_handle<>;
+    auto NextHandle( Worker& worker, SchedulePriority priority ) noexcept -> std::coroutine_handle<>;
+    auto NextNormalHandle( Worker& worker ) noexcept -> std::coroutine_handle<>;
+    auto PopInjected( Worker& worker, Private::InjectionQueue& queue ) noexcept -> std::coroutine_handle<>;
+    auto Spin( Worker& worker ) noexcept -> std::coroutine_handle<>;
+    auto HasQueuedWork() const noexcept -> bool;
+    auto StartWorker( Worker& worker ) -> void;
+    auto SpawnWorker( Node& preferred ) noexcept -> void;
+    auto TryRetire() noexcept -> bool;
+    auto ExpireTimers( Worker& worker ) noexcept -> void;
+    auto FireTimers( Worker* worker, Private::TimerNode* fired, bool expired ) noexcept -> void;
+    auto NeedsTimekeeper() const noexcept -> bool;
     std::atomic<std::size_t> m_size { 0 };
     std::atomic<bool> m_shutdownRequested { false };
 };
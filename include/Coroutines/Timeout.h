@@ -0,0 +1,355 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "Concepts/Awaitable.h"
+#include "Private/AllocatorAwarePromise.h"
+#include "Private/TimerWheel.h"
+#include "Private/VoidValue.h"
+#include "ThreadPool.h"
+
+namespace Coroutines {
+
+namespace Private {
+    // Starts suspended, destroys itself when it finishes.
+    struct DetachedTask {
+        struct promise_type {
+            auto get_return_object() noexcept -> DetachedTask {
+                return DetachedTask { std::coroutine_handle<promise_type>::from_promise( *this ) };
+            }
+            auto initial_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+            auto final_suspend() noexcept -> std::suspend_never {
+                return {};
+            }
+            auto return_void() noexcept -> void {
+            }
+            auto unhandled_exception() noexcept -> void {
+                std::terminate();
+            }
+        };
+
+        std::coroutine_handle<promise_type> m_coroutine;
+    };
+
+    template<typename TResult>
+    using TimeoutResult = std::conditional_t<std::is_void_v<TResult>, bool, std::optional<std::remove_cvref_t<TResult>>>;
+
+    // Stands in for the waiting coroutine in a primitive's waiter list, see AbandoningTimeoutAwaiter.
+    struct WakeRelay {
+        struct promise_type : AllocatorAwarePromise {
+            auto get_return_object() noexcept -> WakeRelay {
+                return WakeRelay { std::coroutine_handle<promise_type>::from_promise( *this ) };
+            }
+            auto initial_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+            auto final_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+            auto return_void() noexcept -> void {
+            }
+            auto unhandled_exception() noexcept -> void {
+                std::terminate();
+            }
+        };
+
+        std::coroutine_handle<promise_type> m_coroutine;
+    };
+
+    // Timeout over an awaiter that can be abandoned, e.g. AsyncMutex::Lock(), Semaphore::Acquire()
+    // or RingBuffer::Consume(). When the timer wins the waiter is unlinked from the primitive
+    // and the coroutine is resumed on the pool.
+    //
+    // The primitive wakes a relay coroutine rather than the waiting one. The coroutine is
+    // resumed by whoever lets go of the awaiter last: await_suspend(), the timer or the relay,
+    // so no side ever waits for another to finish.
+    template<Concepts::CAbandonableAwaiter TAwaiter>
+    class AbandoningTimeoutAwaiter : private TimerNode {
+    public:
+        using TResult = decltype( std::declval<TAwaiter&>().await_resume() );
+
+        AbandoningTimeoutAwaiter( ThreadPool& tp, TAwaiter awaiter, std::chrono::steady_clock::time_point deadline )
+            : m_threadPool( tp )
+            , m_awaiter( std::move( awaiter ) )
+            , m_deadline( deadline ) {
+        }
+        ~AbandoningTimeoutAwaiter() {
+            if( this->m_relay ) {
+                this->m_relay.destroy();
+            }
+        }
+
+        AbandoningTimeoutAwaiter( const AbandoningTimeoutAwaiter& ) = delete;
+        AbandoningTimeoutAwaiter( AbandoningTimeoutAwaiter&& ) = delete;
+        auto operator=( const AbandoningTimeoutAwaiter& ) -> AbandoningTimeoutAwaiter& = delete;
+        auto operator=( AbandoningTimeoutAwaiter&& ) -> AbandoningTimeoutAwaiter& = delete;
+
+        auto await_ready() noexcept -> bool {
+            return this->m_awaiter.await_ready();
+        }
+
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) -> bool {
+            this->m_relay = Relay( *this ).m_coroutine;
+            this->m_awaitingCoroutine = awaiting_coroutine;
+            this->m_phase.store( phase::arming, std::memory_order::relaxed );
+
+            // This call, the timer and the waiter, counted before either can let go.
+            this->m_parties.store( 3, std::memory_order::relaxed );
+            this->m_tick = TimerWheel::DeadlineTick( this->m_deadline );
+            this->m_fire = &AbandoningTimeoutAwaiter::Fire;
+            this->m_armed = this->m_threadPool.AddTimer( *this );
+            if( !this->m_armed ) {
+                this->m_parties.fetch_sub( 1, std::memory_order::relaxed );
+            }
+
+            bool suspended = true;
+            if constexpr( std::is_void_v<decltype( this->m_awaiter.await_suspend( this->m_relay ) )> ) {
+                this->m_awaiter.await_suspend( this->m_relay );
+            } else {
+                suspended = this->m_awaiter.await_suspend( this->m_relay );
+            }
+
+            if( !suspended ) {
+                // Done right away, the timer only has to go.
+                this->m_phase.store( phase::resolved, std::memory_order::release );
+                this->m_parties.fetch_sub( 1, std::memory_order::relaxed );
+                if( this->m_armed ) {
+                    this->m_threadPool.CancelTimer( *this );
+                }
+            } else if( auto expected = phase::arming;
+                       !this->m_phase.compare_exchange_strong( expected, phase::waiting, std::memory_order::acq_rel, std::memory_order::acquire ) ) {
+                // The timer fired before the waiter was linked and left abandoning it to this call.
+                if( this->m_awaiter.Abandon() ) {
+                    this->m_timedOut = true;
+                    this->m_parties.fetch_sub( 1, std::memory_order::relaxed );
+                }
+            }
+
+            // Resumes right away when the others are done already.
+            return !LetGo( 1 );
+        }
+
+        auto await_resume() -> TimeoutResult<TResult> {
+            if( this->m_timedOut ) {
+                return TimeoutResult<TResult> {};
+            }
+
+            if constexpr( std::is_void_v<TResult> ) {
+                this->m_awaiter.await_resume();
+                return true;
+            } else {
+                return TimeoutResult<TResult> { this->m_awaiter.await_resume() };
+            }
+        }
+
+    private:
+        enum class phase { arming, waiting, resolved };
+
+        struct Woken {
+            auto await_ready() const noexcept -> bool {
+                return false;
+            }
+            auto await_suspend( std::coroutine_handle<> ) noexcept -> std::coroutine_handle<> {
+                return this->m_self.OnWoken();
+            }
+            auto await_resume() const noexcept -> void {
+            }
+
+            AbandoningTimeoutAwaiter& m_self;
+        };
+
+        static auto Relay( AbandoningTimeoutAwaiter& self ) -> WakeRelay {
+            co_await Woken { self };
+        }
+
+        // The primitive resumed the relay, the waiter is done.
+        auto OnWoken() noexcept -> std::coroutine_handle<> {
+            if( this->m_armed ) {
+                this->m_threadPool.CancelTimer( *this );
+            }
+            if( LetGo( 1 ) ) {
+                return this->m_awaitingCoroutine;
+            }
+            return std::noop_coroutine();
+        }
+
+        // Runs once the deadline passed, when cancelled or on shutdown, which counts as a
+        // timeout as well.
+        static auto Fire( TimerNode& node, bool ) noexcept -> std::coroutine_handle<> {
+            auto& self = static_cast<AbandoningTimeoutAwaiter&>( node );
+            std::size_t parties = 1;
+            auto expected = phase::arming;
+            if( !self.m_phase.compare_exchange_strong( expected, phase::resolved, std::memory_order::acq_rel, std::memory_order::acquire )
+                && expected == phase::waiting && self.m_awaiter.Abandon() ) {
+                self.m_timedOut = true;
+                // The waiter's share as well, the primitive will not resume the relay.
+                parties = 2;
+            }
+
+            if( self.LetGo( parties ) ) {
+                return self.m_awaitingCoroutine;
+            }
+            return nullptr;
+        }
+
+        // True for the last one, which resumes the coroutine. Nothing may touch the awaiter
+        // after letting go otherwise.
+        auto LetGo( std::size_t parties ) noexcept -> bool {
+            return this->m_parties.fetch_sub( parties, std::memory_order::acq_rel ) == parties;
+        }
+
+        ThreadPool& m_threadPool;
+        TAwaiter m_awaiter;
+        std::chrono::steady_clock::time_point m_deadline;
+        std::coroutine_handle<> m_awaitingCoroutine { nullptr };
+        std::coroutine_handle<> m_relay { nullptr };
+        std::atomic<phase> m_phase { phase::resolved };
+        std::atomic<std::size_t> m_parties { 0 };
+        bool m_armed { false };
+        bool m_timedOut { false };
+    };
+
+    // Timeout over any other awaitable. It is awaited by a detached coroutine that keeps
+    // running after a timeout, its late result is dropped.
+    template<typename TAwaitable>
+    class DetachedTimeoutAwaiter {
+        static auto GetAwaiterOf( TAwaitable&& awaitable ) -> decltype( auto ) {
+            if constexpr( Concepts::CAwaitable<TAwaitable> ) {
+                return std::move( awaitable ).operator co_await();
+            } else {
+                return std::move( awaitable );
+            }
+        }
+
+    public:
+        using TResult = decltype( std::declval<decltype( GetAwaiterOf( std::declval<TAwaitable>() ) )&>().await_resume() );
+
+        DetachedTimeoutAwaiter( ThreadPool& tp, TAwaitable awaitable, std::chrono::steady_clock::time_point deadline )
+            : m_threadPool( tp )
+            , m_awaitable( std::move( awaitable ) )
+            , m_deadline( deadline ) {
+        }
+
+        DetachedTimeoutAwaiter( const DetachedTimeoutAwaiter& ) = delete;
+        DetachedTimeoutAwaiter( DetachedTimeoutAwaiter&& ) = delete;
+        auto operator=( const DetachedTimeoutAwaiter& ) -> DetachedTimeoutAwaiter& = delete;
+        auto operator=( DetachedTimeoutAwaiter&& ) -> DetachedTimeoutAwaiter& = delete;
+
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+
+        auto await_suspend( std::coroutine_handle<> awaiting_coroutine ) -> void {
+            auto state = std::make_shared<State>( this->m_threadPool );
+            state->m_awaitingCoroutine = awaiting_coroutine;
+            state->m_tick = TimerWheel::DeadlineTick( this->m_deadline );
+            state->m_fire = &State::Fire;
+            this->m_state = state;
+            auto detached = AwaitDetached( state, std::move( this->m_awaitable ) );
+
+            // Once the timer is in the wheel the coroutine may resume any time, nothing touches this afterwards.
+            state->m_self = state;
+            if( !this->m_threadPool.AddTimer( *state ) ) {
+                state->m_self = nullptr;
+            }
+            detached.m_coroutine.resume();
+        }
+
+        auto await_resume() -> TimeoutResult<TResult> {
+            auto& state = *this->m_state;
+            if( state.m_timedOut ) {
+                return TimeoutResult<TResult> {};
+            }
+
+            if( state.m_exception ) {
+                std::rethrow_exception( state.m_exception );
+            }
+
+            if constexpr( std::is_void_v<TResult> ) {
+                return true;
+            } else {
+                return TimeoutResult<TResult> { std::move( *state.m_result ) };
+            }
+        }
+
+    private:
+        struct State : TimerNode {
+            explicit State( ThreadPool& tp ) noexcept
+                : m_threadPool( tp ) {
+            }
+
+            static auto Fire( TimerNode& node, bool ) noexcept -> std::coroutine_handle<> {
+                auto& state = static_cast<State&>( node );
+                auto self = std::move( state.m_self );
+                if( state.m_claimed.exchange( true, std::memory_order::acq_rel ) ) {
+                    return nullptr;
+                }
+
+                state.m_timedOut = true;
+                return state.m_awaitingCoroutine;
+            }
+
+            ThreadPool& m_threadPool;
+            std::coroutine_handle<> m_awaitingCoroutine { nullptr };
+            // Whoever sets it first, the timer or the awaited operation, resumes the coroutine.
+            std::atomic<bool> m_claimed { false };
+            bool m_timedOut { false };
+            std::conditional_t<std::is_void_v<TResult>, std::optional<void_value>, std::optional<std::remove_cvref_t<TResult>>> m_result;
+            std::exception_ptr m_exception { nullptr };
+            // Keeps the state alive while the timer is in the wheel.
+            std::shared_ptr<State> m_self;
+        };
+
+        static auto AwaitDetached( std::shared_ptr<State> state, TAwaitable awaitable ) -> DetachedTask {
+            try {
+                if constexpr( std::is_void_v<TResult> ) {
+                    co_await std::move( awaitable );
+                    state->m_result.emplace();
+                } else {
+                    state->m_result.emplace( co_await std::move( awaitable ) );
+                }
+            } catch( ... ) {
+                state->m_exception = std::current_exception();
+            }
+
+            if( !state->m_claimed.exchange( true, std::memory_order::acq_rel ) ) {
+                state->m_threadPool.CancelTimer( *state );
+                state->m_awaitingCoroutine.resume();
+            }
+        }
+
+        ThreadPool& m_threadPool;
+        TAwaitable m_awaitable;
+        std::chrono::steady_clock::time_point m_deadline;
+        std::shared_ptr<State> m_state;
+    };
+}
+
+// co_await yields the awaitable's result in a std::optional, or true for a void result, and
+// nullopt / false when the deadline passed first. A timed out coroutine resumes on tp.
+// Awaiters satisfying CAbandonableAwaiter leave their primitive's waiter list on timeout,
+// anything else is awaited by a detached coroutine that runs to completion on its own.
+template<typename TAwaitable>
+[[nodiscard]] auto WithDeadline( ThreadPool& tp, TAwaitable awaitable, std::chrono::steady_clock::time_point deadline ) {
+    if constexpr( Concepts::CAbandonableAwaiter<TAwaitable> ) {
+        return Private::AbandoningTimeoutAwaiter<TAwaitable> { tp, std::move( awaitable ), deadline };
+    } else {
+        return Private::DetachedTimeoutAwaiter<TAwaitable> { tp, std::move( awaitable ), deadline };
+    }
+}
+
+template<typename TAwaitable>
+[[nodiscard]] auto WithTimeout( ThreadPool& tp, TAwaitable awaitable, std::chrono::steady_clock::duration timeout ) {
+    return WithDeadline( tp, std::move( awaitable ), std::chrono::steady_clock::now() + timeout );
+}
+
+}
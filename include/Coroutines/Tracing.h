@@ -0,0 +1,21 @@
+#pragma once
+
+#include <filesystem>
+
+#include "Private/Trace.h"
+
+namespace Coroutines::Tracing {
+
+// Records task creation, resumption on ThreadPool workers and suspension in Task, AsyncMutex
+// and RingBuffer awaits into per-thread buffers. Only available when the library is built
+// with COROUTINES_TRACING, otherwise nothing is recorded.
+auto Start() noexcept -> void;
+auto Stop() noexcept -> void;
+auto IsAvailable() noexcept -> bool;
+// Drops the events recorded so far. Call it while tracing is stopped and no thread records.
+auto Clear() -> void;
+// Writes the recorded events in the Chrome trace event format, which chrome://tracing and
+// the Perfetto UI open. Call it while tracing is stopped and no thread records.
+auto WriteChromeJson( const std::filesystem::path& path ) -> void;
+
+}
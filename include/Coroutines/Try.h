@@ -0,0 +1,75 @@
+#pragma once
+
+#include <coroutine>
+#include <expected>
+#include <type_traits>
+#include <utility>
+
+#include "Task.h"
+
+namespace Coroutines {
+
+namespace Private {
+    template<typename TValue, typename TError>
+    class TryAwaitable {
+    public:
+        using TTask = Task<std::expected<TValue, TError>>;
+
+        explicit TryAwaitable( TTask&& task ) noexcept
+            : m_task( std::move( task ) ) {
+        }
+
+        auto await_ready() noexcept -> bool {
+            return this->m_task.is_ready() && !this->m_task.promise().Failed();
+        }
+
+        template<typename TPromise>
+        auto await_suspend( std::coroutine_handle<TPromise> awaiting_coroutine ) noexcept -> std::coroutine_handle<> {
+            static_assert( requires { awaiting_coroutine.promise().CompleteWithError( std::declval<TError>() ); },
+                           "Coroutines::Try must be awaited in a Task<std::expected<T, E>> whose E can be made of the awaited error." );
+
+            auto& promise = this->m_task.promise();
+            if( this->m_task.is_ready() ) {
+                // The awaited frame goes first, the awaiting one may be destroyed on another thread once completed.
+                auto error = std::move( promise ).result().error();
+                this->m_task.destroy();
+                return awaiting_coroutine.promise().CompleteWithError( std::move( error ) );
+            }
+
+            promise.continuation( awaiting_coroutine );
+            promise.PropagateTo( awaiting_coroutine.address(), &Propagate<TPromise> );
+            return this->m_task.handle();
+        }
+
+        auto await_resume() -> decltype( auto ) {
+            if constexpr( std::is_void_v<TValue> ) {
+                std::move( this->m_task.promise() ).result();
+                return;
+            } else {
+                return *std::move( this->m_task.promise() ).result();
+            }
+        }
+
+    private:
+        template<typename TPromise>
+        static auto Propagate( void* awaiting, TError&& error ) noexcept -> std::coroutine_handle<> {
+            return std::coroutine_handle<TPromise>::from_address( awaiting ).promise().CompleteWithError( std::move( error ) );
+        }
+
+        TTask m_task;
+    };
+}
+
+// Inside a Task<std::expected<T, E>>, co_await Try( task ) gives the value of the
+// std::expected<U, E2> the task returns. On an error the awaiting Task completes right away
+// with std::unexpected( error ), like ? in Rust, without throwing or being resumed. It then
+// counts as ready but stays suspended at the co_await, its locals alive until the frame is
+// destroyed along with the Task. co_await on the Task as an rvalue, e.g. straight on the call,
+// takes the result by value and destroys the frame, and those of the Tasks it awaited through
+// Try(), before the awaiting coroutine goes on. Exceptions propagate as with co_await task.
+template<typename TValue, typename TError>
+[[nodiscard]] auto Try( Task<std::expected<TValue, TError>>&& task ) -> Private::TryAwaitable<TValue, TError> {
+    return Private::TryAwaitable<TValue, TError> { std::move( task ) };
+}
+
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "Concepts/Awaitable.h"
+#include "Private/AllocatorAwarePromise.h"
 #include "Private/VoidValue.h"
 
 #include <atomic>
 #include <coroutine>
+#include <memory>
 #include <ranges>
 #include <tuple>
 #include <vector>
@@ -155,7 +157,7 @@ namespace Private {
         }
 
         auto try_await( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
-            std::apply( [ this ]( auto&&... tasks ) { ( ( tasks.Start( m_latch ) ), ... ); }, m_tasks );
+            std::apply( [ this ]( auto&&... tasks ) { ( ( tasks.start( m_latch ) ), ... ); }, m_tasks );
             return m_latch.try_await( awaiting_coroutine );
         }
 
@@ -173,8 +175,8 @@ namespace Private {
 
         WhenAllReadyAwaitable( const WhenAllReadyAwaitable& ) = delete;
         WhenAllReadyAwaitable( WhenAllReadyAwaitable&& other ) noexcept( std::is_nothrow_move_constructible_v<task_container_type> )
-            : WhenAllLatch( std::move( other.m_latch ) )
-            , m_tasks( std::move( m_tasks ) ) {
+            : m_latch( std::move( other.m_latch ) )
+            , m_tasks( std::move( other.m_tasks ) ) {
         }
 
         auto operator=( const WhenAllReadyAwaitable& ) -> WhenAllReadyAwaitable& = delete;
@@ -237,7 +239,7 @@ namespace Private {
 
         auto try_await( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
             for( auto& task: m_tasks ) {
-                task.Start( m_latch );
+                task.start( m_latch );
             }
 
             return m_latch.try_await( awaiting_coroutine );
@@ -248,7 +250,7 @@ namespace Private {
     };
 
     template<typename return_type>
-    class WhenAllTaskPromise {
+    class WhenAllTaskPromise : public AllocatorAwarePromise {
     public:
         using coroutine_handle_type = std::coroutine_handle<WhenAllTaskPromise<return_type>>;
 
@@ -303,7 +305,7 @@ namespace Private {
             if( m_exception_ptr ) {
                 std::rethrow_exception( m_exception_ptr );
             }
-            return std::forward( *m_return_value );
+            return std::forward<return_type>( *m_return_value );
         }
 
     private:
@@ -313,7 +315,7 @@ namespace Private {
     };
 
     template<>
-    class WhenAllTaskPromise<void> {
+    class WhenAllTaskPromise<void> : public AllocatorAwarePromise {
     public:
         using coroutine_handle_type = std::coroutine_handle<WhenAllTaskPromise<void>>;
 
@@ -438,6 +440,16 @@ namespace Private {
         }
     }
 
+    template<Concepts::CAwaitable awaitable, typename TAlloc, typename return_type = typename Concepts::CAwaitableTraits<awaitable&&>::TAwaiterResult>
+    static auto MakeWhenAllTask( std::allocator_arg_t, const TAlloc&, awaitable a ) -> WhenAllTask<return_type> {
+        if constexpr( std::is_void_v<return_type> ) {
+            co_await static_cast<awaitable&&>( a );
+            co_return;
+        } else {
+            co_yield co_await static_cast<awaitable&&>( a );
+        }
+    }
+
 } // namespace detail
 
 template<Concepts::CAwaitable... awaitables_type>
@@ -459,4 +471,27 @@ template<std::ranges::range range_type, Concepts::CAwaitable awaitable_type = st
     return Private::WhenAllReadyAwaitable( std::move( output_tasks ) );
 }
 
+// The frames of the tasks awaiting each awaitable come from alloc.
+template<typename TAlloc, Concepts::CAwaitable... awaitables_type>
+[[nodiscard]] auto WhenAll( std::allocator_arg_t, const TAlloc& alloc, awaitables_type... awaitables ) {
+    return Private::WhenAllReadyAwaitable<std::tuple<Private::WhenAllTask<typename Concepts::CAwaitableTraits<awaitables_type>::TAwaiterResult>...>>(
+        std::make_tuple( Private::MakeWhenAllTask( std::allocator_arg, alloc, std::move( awaitables ) )... ) );
+}
+
+// The task list is allocated from alloc too.
+template<typename TAlloc, std::ranges::range range_type, Concepts::CAwaitable awaitable_type = std::ranges::range_value_t<range_type>,
+         typename return_type = typename Concepts::CAwaitableTraits<awaitable_type>::TAwaiterResult,
+         typename task_allocator_type = typename std::allocator_traits<TAlloc>::template rebind_alloc<Private::WhenAllTask<return_type>>>
+[[nodiscard]] auto WhenAll( std::allocator_arg_t, const TAlloc& alloc, range_type awaitables )
+    -> Private::WhenAllReadyAwaitable<std::vector<Private::WhenAllTask<return_type>, task_allocator_type>> {
+    std::vector<Private::WhenAllTask<return_type>, task_allocator_type> output_tasks { task_allocator_type( alloc ) };
+    if constexpr( std::ranges::sized_range<range_type> ) {
+        output_tasks.reserve( std::size( awaitables ) );
+    }
+    for( auto& a: awaitables ) {
+        output_tasks.emplace_back( Private::MakeWhenAllTask( std::allocator_arg, alloc, std::move( a ) ) );
+    }
+    return Private::WhenAllReadyAwaitable( std::move( output_tasks ) );
+}
+
 } // namespace Coroutines
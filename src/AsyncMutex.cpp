@@ -1,5 +1,8 @@
 #include "Coroutines/AsyncMutex.h"
 
+#include "Coroutines/Private/CooperativeBudget.h"
+#include "Coroutines/Private/Trace.h"
+
 
 namespace Coroutines {
 AsyncMutexLock::~AsyncMutexLock() {
@@ -14,58 +17,114 @@ auto AsyncMutexLock::Unlock() -> void {
     }
 }
 
-auto AsyncMutex::LockOperation::await_ready() const noexcept -> bool {
-    if( this->m_mutex.TryLock() ) {
-        std::atomic_thread_fence( std::memory_order::acquire );
-        return true;
+auto AsyncMutex::LockOperation::await_ready() noexcept -> bool {
+    if( !this->m_mutex.TryLock() ) {
+        return false;
     }
-    return false;
+
+    std::atomic_thread_fence( std::memory_order::acquire );
+    // Out of budget, await_suspend() reschedules with the lock held.
+    this->m_acquired = true;
+    return Private::CooperativeBudget::Consume();
 }
 
 auto AsyncMutex::LockOperation::await_suspend( std::coroutine_handle<> awaitingCoroutine ) noexcept -> bool {
+    if( this->m_acquired ) {
+        Private::CooperativeBudget::Reschedule( awaitingCoroutine );
+        return true;
+    }
+
+    std::unique_lock lk { this->m_mutex.m_waiterMutex };
+    auto current = this->m_mutex.m_state.load( std::memory_order::relaxed );
+    while( !this->m_mutex.m_state.compare_exchange_weak( current, current == state::unlocked ? state::locked : state::locked_with_waiters,
+                                                         std::memory_order::acq_rel, std::memory_order::relaxed ) ) {
+    }
+
+    if( current == state::unlocked ) {
+        lk.unlock();
+        return Private::CooperativeBudget::YieldIfExhausted( awaitingCoroutine );
+    }
+
     this->m_awaitingCoroutine = awaitingCoroutine;
-    void* current = this->m_mutex.m_state.load( std::memory_order::acquire );
-    void* new_value;
+    this->m_prev = this->m_mutex.m_waitersTail;
+    this->m_next = nullptr;
+    if( this->m_prev != nullptr ) {
+        this->m_prev->m_next = this;
+    } else {
+        this->m_mutex.m_waitersHead = this;
+    }
+    this->m_mutex.m_waitersTail = this;
+    this->m_waiting = true;
 
-    const void* unlockedValue = this->m_mutex.UnlockedValue();
-    do {
-        if( current == unlockedValue ) {
-            new_value = nullptr;
-        } else {
-            this->m_next = static_cast<LockOperation*>( current );
-            new_value = static_cast<void*>( this );
-        }
-    } while( !m_mutex.m_state.compare_exchange_weak( current, new_value, std::memory_order::acq_rel ) );
+    // Only the local handle, the operation may already be resumed elsewhere once unlocked.
+    COROUTINES_TRACE_SUSPEND( awaitingCoroutine.address(), "mutex wait" );
+    return true;
+}
 
-    if( current == unlockedValue ) {
-        std::atomic_thread_fence( std::memory_order::acquire );
-        this->m_awaitingCoroutine = nullptr;
+auto AsyncMutex::LockOperation::Abandon() noexcept -> bool {
+    std::scoped_lock lk { this->m_mutex.m_waiterMutex };
+    if( !this->m_waiting ) {
         return false;
     }
 
+    if( this->m_prev != nullptr ) {
+        this->m_prev->m_next = this->m_next;
+    } else {
+        this->m_mutex.m_waitersHead = this->m_next;
+    }
+    if( this->m_next != nullptr ) {
+        this->m_next->m_prev = this->m_prev;
+    } else {
+        this->m_mutex.m_waitersTail = this->m_prev;
+    }
+    this->m_waiting = false;
+
+    // Still held by someone, who may now unlock without taking m_waiterMutex.
+    if( this->m_mutex.m_waitersHead == nullptr ) {
+        this->m_mutex.m_state.store( state::locked, std::memory_order::relaxed );
+    }
     return true;
 }
 
 auto AsyncMutex::TryLock() -> bool {
-    void* expected = const_cast<void*>( UnlockedValue() );
-    return this->m_state.compare_exchange_strong( expected, nullptr, std::memory_order::acq_rel, std::memory_order::relaxed );
+    auto expected = state::unlocked;
+    return this->m_state.compare_exchange_strong( expected, state::locked, std::memory_order::acq_rel, std::memory_order::relaxed );
 }
 
 auto AsyncMutex::Unlock() -> void {
-    if( this->m_internalWaiters == nullptr ) {
-        void* current = this->m_state.load( std::memory_order::relaxed );
-        if( current == nullptr ) {
-            if( this->m_state.compare_exchange_strong( current, const_cast<void*>( UnlockedValue() ), std::memory_order::release,
-                                                       std::memory_order::relaxed ) ) {
-                return;
-            }
-        }
+    auto expected = state::locked;
+    if( this->m_state.compare_exchange_strong( expected, state::unlocked, std::memory_order::release, std::memory_order::relaxed ) ) {
+        return;
+    }
 
-        this->m_internalWaiters = static_cast<LockOperation*>( this->m_state.exchange( nullptr, std::memory_order::acq_rel ) );
+    std::unique_lock lk { this->m_waiterMutex };
+    auto* to_resume = PopWaiter();
+    if( to_resume == nullptr ) {
+        // The waiters abandoned the lock in the meantime.
+        this->m_state.store( state::unlocked, std::memory_order::release );
+        return;
     }
-    LockOperation* to_resume = this->m_internalWaiters;
-    this->m_internalWaiters = this->m_internalWaiters->m_next;
+
+    // Ownership passes straight to the waiter.
+    if( this->m_waitersHead == nullptr ) {
+        this->m_state.store( state::locked, std::memory_order::relaxed );
+    }
+    lk.unlock();
     to_resume->m_awaitingCoroutine.resume();
 }
 
+auto AsyncMutex::PopWaiter() noexcept -> LockOperation* {
+    auto* waiter = this->m_waitersHead;
+    if( waiter != nullptr ) {
+        this->m_waitersHead = waiter->m_next;
+        if( this->m_waitersHead != nullptr ) {
+            this->m_waitersHead->m_prev = nullptr;
+        } else {
+            this->m_waitersTail = nullptr;
+        }
+        waiter->m_waiting = false;
+    }
+    return waiter;
+}
+
 }
@@ -0,0 +1,157 @@
+#include "Coroutines/Private/CpuTopology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Coroutines::Private {
+namespace {
+    // Parses the kernel's cpulist format, e.g. "0-3,8-11".
+    auto ParseCpuList( const std::string& text ) -> std::vector<uint32_t> {
+        std::vector<uint32_t> cpus;
+        std::size_t pos = 0;
+        while( pos < text.size() ) {
+            auto end = text.find( ',', pos );
+            if( end == std::string::npos ) {
+                end = text.size();
+            }
+
+            const auto range = text.substr( pos, end - pos );
+            pos = end + 1;
+            if( range.empty() || range.front() < '0' || range.front() > '9' ) {
+                continue;
+            }
+
+            const auto dash = range.find( '-' );
+            const auto first = static_cast<uint32_t>( std::stoul( range.substr( 0, dash ) ) );
+            const auto last = dash == std::string::npos ? first : static_cast<uint32_t>( std::stoul( range.substr( dash + 1 ) ) );
+            for( auto cpu = first; cpu <= last; ++cpu ) {
+                cpus.emplace_back( cpu );
+            }
+        }
+
+        return cpus;
+    }
+
+    auto ReadCpuList( const std::filesystem::path& path ) -> std::vector<uint32_t> {
+        std::ifstream file { path };
+        std::string text;
+        if( !file || !std::getline( file, text ) ) {
+            return {};
+        }
+
+        try {
+            return ParseCpuList( text );
+        } catch( const std::exception& ) {
+            return {};
+        }
+    }
+
+    auto ReadNodes() -> std::vector<std::vector<uint32_t>> {
+        std::vector<std::pair<unsigned long, std::vector<uint32_t>>> nodes;
+
+        std::error_code ec;
+        for( const auto& entry: std::filesystem::directory_iterator( "/sys/devices/system/node", ec ) ) {
+            const auto name = entry.path().filename().string();
+            if( name.size() <= 4 || name.compare( 0, 4, "node" ) != 0 || !std::all_of( name.begin() + 4, name.end(), []( char c ) { return c >= '0' && c <= '9'; } ) ) {
+                continue;
+            }
+
+            auto cpus = ReadCpuList( entry.path() / "cpulist" );
+            if( !cpus.empty() ) {
+                nodes.emplace_back( std::stoul( name.substr( 4 ) ), std::move( cpus ) );
+            }
+        }
+
+        std::sort( nodes.begin(), nodes.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+        std::vector<std::vector<uint32_t>> result;
+        for( auto& [ id, cpus ]: nodes ) {
+            result.emplace_back( std::move( cpus ) );
+        }
+
+        if( result.empty() ) {
+            auto cpus = ReadCpuList( "/sys/devices/system/cpu/online" );
+            if( cpus.empty() ) {
+                for( uint32_t cpu = 0; cpu < std::max( 1u, std::thread::hardware_concurrency() ); ++cpu ) {
+                    cpus.emplace_back( cpu );
+                }
+            }
+            result.emplace_back( std::move( cpus ) );
+        }
+
+        return result;
+    }
+}
+
+auto CpuTopology::Read() -> CpuTopology {
+    CpuTopology topology;
+    topology.m_nodes = ReadNodes();
+
+    for( const auto& node: topology.m_nodes ) {
+        for( auto cpu: node ) {
+            const auto siblings = ReadCpuList( "/sys/devices/system/cpu/cpu" + std::to_string( cpu ) + "/topology/thread_siblings_list" );
+            if( siblings.empty() || siblings.front() == cpu ) {
+                topology.m_cores.emplace_back( cpu );
+            }
+        }
+    }
+
+    return topology;
+}
+
+auto CpuTopology::NodeOf( uint32_t cpu ) const noexcept -> std::size_t {
+    for( std::size_t i = 0; i < this->m_nodes.size(); ++i ) {
+        if( std::find( this->m_nodes[ i ].begin(), this->m_nodes[ i ].end(), cpu ) != this->m_nodes[ i ].end() ) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+auto CpuTopology::MaxCpu() const noexcept -> uint32_t {
+    uint32_t result = 0;
+    for( const auto& node: this->m_nodes ) {
+        for( auto cpu: node ) {
+            result = std::max( result, cpu );
+        }
+    }
+
+    return result;
+}
+
+auto PinCurrentThread( const std::vector<uint32_t>& cpus ) noexcept -> bool {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    for( auto cpu: cpus ) {
+        if( cpu < CPU_SETSIZE ) {
+            CPU_SET( cpu, &set );
+        }
+    }
+
+    return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+auto CurrentCpu() noexcept -> int {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+}
@@ -47,7 +47,7 @@ auto Event::Awaiter::await_suspend( std::coroutine_handle<> awaitingCoroutine )
     void* old_value = this->m_event.m_state.load( std::memory_order::acquire );
     do {
         if( old_value == set_state ) {
-            return false;
+            return Private::CooperativeBudget::YieldIfExhausted( awaitingCoroutine );
         }
 
         this->m_next = static_cast<Awaiter*>( old_value );
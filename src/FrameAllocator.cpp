@@ -0,0 +1,291 @@
+#include "Coroutines/FrameAllocator.h"
+
+#include "Coroutines/Private/OwnerCounter.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Coroutines {
+
+namespace {
+    struct Cache;
+
+    // Precedes every frame, keeps the frame at the default new alignment.
+    struct alignas( __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) Header {
+        // nullptr for frames that skip the free lists.
+        Cache* m_owner;
+        std::uint32_t m_sizeClass;
+    };
+
+    // Cached and in-transit frames are chained through their first bytes.
+    auto NextOf( Header* header ) noexcept -> Header*& {
+        return *reinterpret_cast<Header**>( header + 1 );
+    }
+
+    auto BlockSize( std::uint32_t sizeClass ) noexcept -> std::size_t {
+        return ( sizeClass + 1 ) * FrameAllocator::GRANULARITY;
+    }
+
+    auto PushRemote( Cache& owner, Header* head, Header* tail ) noexcept -> void;
+
+    std::atomic<std::size_t> s_threadCacheLimit { std::size_t { 1 } << 20 };
+
+    struct Cache {
+        static constexpr std::size_t BATCH_SLOTS = 8;
+
+        struct batch {
+            Cache* m_owner { nullptr };
+            Header* m_head { nullptr };
+            Header* m_tail { nullptr };
+            std::size_t m_size { 0 };
+        };
+
+        auto Push( Header* header ) noexcept -> void {
+            const auto size = BlockSize( header->m_sizeClass );
+            if( this->m_bytes + size > s_threadCacheLimit.load( std::memory_order::relaxed ) ) {
+                ::operator delete( header );
+                return;
+            }
+
+            NextOf( header ) = this->m_free[ header->m_sizeClass ];
+            this->m_free[ header->m_sizeClass ] = header;
+            this->m_bytes += size;
+            this->m_cachedBytes.store( this->m_bytes, std::memory_order::relaxed );
+        }
+
+        auto Pop( std::uint32_t sizeClass ) noexcept -> Header* {
+            auto* header = this->m_free[ sizeClass ];
+            if( header == nullptr ) {
+                return nullptr;
+            }
+
+            this->m_free[ sizeClass ] = NextOf( header );
+            this->m_bytes -= BlockSize( sizeClass );
+            this->m_cachedBytes.store( this->m_bytes, std::memory_order::relaxed );
+            return header;
+        }
+
+        // Moves the frames other threads handed back into the free lists.
+        auto TakeRemote() noexcept -> void {
+            auto* header = this->m_remote.exchange( nullptr, std::memory_order::acquire );
+            while( header != nullptr ) {
+                auto* next = NextOf( header );
+                Push( header );
+                header = next;
+            }
+        }
+
+        auto AddToBatch( Cache& owner, Header* header ) noexcept -> void {
+            auto& batch = this->m_batches[ ( reinterpret_cast<std::uintptr_t>( &owner ) >> 6 ) % BATCH_SLOTS ];
+            if( batch.m_owner != &owner ) {
+                Flush( batch );
+                batch.m_owner = &owner;
+            }
+
+            NextOf( header ) = batch.m_head;
+            batch.m_head = header;
+            if( batch.m_tail == nullptr ) {
+                batch.m_tail = header;
+            }
+            if( ++batch.m_size == FrameAllocator::REMOTE_BATCH_SIZE ) {
+                Flush( batch );
+            }
+        }
+
+        static auto Flush( batch& batch ) noexcept -> void {
+            if( batch.m_head != nullptr ) {
+                PushRemote( *batch.m_owner, batch.m_head, batch.m_tail );
+            }
+            batch = {};
+        }
+
+        // The owning thread releases everything it holds before leaving the cache behind.
+        auto Release() noexcept -> void {
+            for( auto& batch: this->m_batches ) {
+                Flush( batch );
+            }
+
+            TakeRemote();
+            for( auto& head: this->m_free ) {
+                while( head != nullptr ) {
+                    ::operator delete( std::exchange( head, NextOf( head ) ) );
+                }
+            }
+            this->m_bytes = 0;
+            this->m_cachedBytes.store( 0, std::memory_order::relaxed );
+        }
+
+        // Owner only.
+        std::array<Header*, FrameAllocator::SIZE_CLASSES> m_free {};
+        std::size_t m_bytes { 0 };
+        std::array<batch, BATCH_SLOTS> m_batches {};
+
+        Private::OwnerCounter m_allocated;
+        Private::OwnerCounter m_freed;
+        Private::OwnerCounter m_remoteFrees;
+        Private::OwnerCounter m_misses;
+        std::atomic<std::size_t> m_cachedBytes { 0 };
+
+        // Frames of this cache freed on other threads.
+        alignas( 64 ) std::atomic<Header*> m_remote { nullptr };
+    };
+
+    auto PushRemote( Cache& owner, Header* head, Header* tail ) noexcept -> void {
+        auto* remote = owner.m_remote.load( std::memory_order::relaxed );
+        do {
+            NextOf( tail ) = remote;
+        } while( !owner.m_remote.compare_exchange_weak( remote, head, std::memory_order::release, std::memory_order::relaxed ) );
+    }
+
+    // Caches are never freed, frames may still point at them after their thread exited.
+    struct Registry {
+        std::mutex m_mutex;
+        std::vector<Cache*> m_caches;
+        std::vector<Cache*> m_orphans;
+        // Threads past their cache's release allocate and free without one.
+        std::atomic<std::uint64_t> m_allocatedWithoutCache { 0 };
+        std::atomic<std::uint64_t> m_freedWithoutCache { 0 };
+    };
+
+    auto GetRegistry() noexcept -> Registry& {
+        static auto* registry = new Registry {};
+        return *registry;
+    }
+
+    thread_local Cache* t_cache = nullptr;
+    thread_local bool t_released = false;
+
+    auto ReleaseCache() noexcept -> void {
+        auto* cache = std::exchange( t_cache, nullptr );
+        t_released = true;
+        if( cache == nullptr ) {
+            return;
+        }
+
+        cache->Release();
+        auto& registry = GetRegistry();
+        std::scoped_lock lk { registry.m_mutex };
+        registry.m_orphans.emplace_back( cache );
+    }
+
+    struct CacheRelease {
+        ~CacheRelease() {
+            ReleaseCache();
+        }
+    };
+
+    // nullptr once the thread released its cache, or when no cache could be set up.
+    auto AcquireCache() noexcept -> Cache* {
+        if( t_released ) {
+            return nullptr;
+        }
+
+        try {
+            thread_local CacheRelease release;
+            auto& registry = GetRegistry();
+            std::scoped_lock lk { registry.m_mutex };
+            if( !registry.m_orphans.empty() ) {
+                t_cache = registry.m_orphans.back();
+                registry.m_orphans.pop_back();
+            } else {
+                registry.m_caches.reserve( registry.m_caches.size() + 1 );
+                t_cache = registry.m_caches.emplace_back( new Cache {} );
+            }
+        } catch( ... ) {
+            t_cache = nullptr;
+        }
+        return t_cache;
+    }
+
+    auto LocalCache() noexcept -> Cache* {
+        if( t_cache != nullptr ) [[likely]] {
+            return t_cache;
+        }
+        return AcquireCache();
+    }
+}
+
+auto FrameAllocator::Allocate( std::size_t size ) -> void* {
+    auto* cache = LocalCache();
+    if( cache == nullptr ) {
+        GetRegistry().m_allocatedWithoutCache.fetch_add( 1, std::memory_order::relaxed );
+    } else {
+        cache->m_allocated.Add();
+    }
+
+    const auto total = size + sizeof( Header );
+    if( total > MAX_FRAME_SIZE || cache == nullptr ) {
+        auto* header = static_cast<Header*>( ::operator new( total ) );
+        header->m_owner = nullptr;
+        return header + 1;
+    }
+
+    const auto sizeClass = static_cast<std::uint32_t>( ( total - 1 ) / GRANULARITY );
+    auto* header = cache->Pop( sizeClass );
+    if( header == nullptr ) {
+        cache->TakeRemote();
+        header = cache->Pop( sizeClass );
+    }
+    if( header == nullptr ) {
+        cache->m_misses.Add();
+        header = static_cast<Header*>( ::operator new( BlockSize( sizeClass ) ) );
+    }
+
+    header->m_owner = cache;
+    header->m_sizeClass = sizeClass;
+    return header + 1;
+}
+
+auto FrameAllocator::Deallocate( void* frame ) noexcept -> void {
+    if( frame == nullptr ) {
+        return;
+    }
+
+    auto* header = static_cast<Header*>( frame ) - 1;
+    auto* cache = LocalCache();
+    if( cache == nullptr ) {
+        GetRegistry().m_freedWithoutCache.fetch_add( 1, std::memory_order::relaxed );
+    } else {
+        cache->m_freed.Add();
+    }
+
+    auto* owner = header->m_owner;
+    if( owner == nullptr ) {
+        ::operator delete( header );
+    } else if( owner == cache ) {
+        cache->Push( header );
+    } else if( cache != nullptr ) {
+        cache->m_remoteFrees.Add();
+        cache->AddToBatch( *owner, header );
+    } else {
+        PushRemote( *owner, header, header );
+    }
+}
+
+auto FrameAllocator::SetThreadCacheLimit( std::size_t bytes ) noexcept -> void {
+    s_threadCacheLimit.store( bytes, std::memory_order::relaxed );
+}
+
+auto FrameAllocator::Metrics() -> metrics {
+    auto& registry = GetRegistry();
+    std::uint64_t allocated = registry.m_allocatedWithoutCache.load( std::memory_order::relaxed );
+    std::uint64_t freed = registry.m_freedWithoutCache.load( std::memory_order::relaxed );
+    metrics result {};
+
+    std::scoped_lock lk { registry.m_mutex };
+    for( auto* cache: registry.m_caches ) {
+        allocated += cache->m_allocated.Load();
+        freed += cache->m_freed.Load();
+        result.bytes_cached += cache->m_cachedBytes.load( std::memory_order::relaxed );
+        result.remote_frees += cache->m_remoteFrees.Load();
+        result.misses += cache->m_misses.Load();
+    }
+    result.frames_in_use = allocated > freed ? allocated - freed : 0;
+    return result;
+}
+
+}
@@ -0,0 +1,81 @@
+#include "Coroutines/FrameArena.h"
+
+#include <new>
+
+namespace Coroutines {
+
+namespace Private {
+    FrameArenaState::FrameArenaState( std::size_t blockSize ) noexcept
+        : m_owner( ThisThread() )
+        , m_blockSize( ( blockSize + sizeof( Header ) - 1 ) & ~( sizeof( Header ) - 1 ) ) {
+    }
+
+    auto FrameArenaState::DeallocateRemote( Block* block ) noexcept -> void {
+        if( block->m_balance.fetch_sub( 1, std::memory_order::acq_rel ) == 1 ) {
+            Free( block );
+        }
+    }
+
+    auto FrameArenaState::NextBlock( std::size_t total ) -> Block* {
+        if( total > this->m_blockSize ) {
+            return nullptr;
+        }
+
+        if( auto* block = this->m_block ) {
+            // Frees only count down, nobody touches the block once they made up for every allocation.
+            if( block->m_balance.load( std::memory_order::acquire ) + block->m_allocated == 0 ) {
+                block->m_balance.store( 0, std::memory_order::relaxed );
+                block->m_offset = 0;
+                block->m_allocated = 0;
+                return block;
+            }
+
+            this->m_block = nullptr;
+            Retire( block );
+        }
+
+        auto* block = static_cast<Block*>( ::operator new( sizeof( Block ) + this->m_blockSize ) );
+        ::new( block ) Block { .m_state = this, .m_capacity = this->m_blockSize };
+        this->m_references.fetch_add( 1, std::memory_order::relaxed );
+        this->m_block = block;
+        return block;
+    }
+
+    auto FrameArenaState::Retire( Block* block ) noexcept -> void {
+        const auto allocated = block->m_allocated;
+        if( block->m_balance.fetch_add( allocated, std::memory_order::acq_rel ) + allocated == 0 ) {
+            Free( block );
+        }
+    }
+
+    auto FrameArenaState::Free( Block* block ) noexcept -> void {
+        auto* state = block->m_state;
+        block->~Block();
+        ::operator delete( block );
+        state->Release();
+    }
+
+    auto FrameArenaState::Close() noexcept -> void {
+        this->m_closed = true;
+        if( auto* block = std::exchange( this->m_block, nullptr ) ) {
+            Retire( block );
+        }
+        Release();
+    }
+
+    auto FrameArenaState::Release() noexcept -> void {
+        if( this->m_references.fetch_sub( 1, std::memory_order::acq_rel ) == 1 ) {
+            delete this;
+        }
+    }
+}
+
+FrameArena::FrameArena( options opts )
+    : m_state( new Private::FrameArenaState( opts.block_size ) ) {
+}
+
+FrameArena::~FrameArena() {
+    this->m_state->Close();
+}
+
+}
@@ -0,0 +1,59 @@
+#include "Coroutines/Histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Coroutines {
+
+auto Histogram::Record( std::chrono::nanoseconds value, std::uint64_t count ) -> void {
+    const auto ns = static_cast<std::uint64_t>( std::max<std::chrono::nanoseconds::rep>( value.count(), 0 ) );
+    Add( BucketOf( ns ), count );
+    this->m_sum += ns * count;
+    this->m_max = std::max( this->m_max, ns );
+}
+
+auto Histogram::Merge( const Histogram& other ) -> void {
+    for( std::size_t bucket = 0; bucket < other.m_counts.size(); ++bucket ) {
+        if( other.m_counts[ bucket ] != 0 ) {
+            Add( bucket, other.m_counts[ bucket ] );
+        }
+    }
+    this->m_sum += other.m_sum;
+    this->m_max = std::max( this->m_max, other.m_max );
+}
+
+auto Histogram::Min() const noexcept -> std::chrono::nanoseconds {
+    for( std::size_t bucket = 0; bucket < this->m_counts.size(); ++bucket ) {
+        if( this->m_counts[ bucket ] != 0 ) {
+            return std::chrono::nanoseconds { LowestValueOf( bucket ) };
+        }
+    }
+    return std::chrono::nanoseconds { 0 };
+}
+
+auto Histogram::Percentile( double percentile ) const noexcept -> std::chrono::nanoseconds {
+    if( this->m_count == 0 ) {
+        return std::chrono::nanoseconds { 0 };
+    }
+
+    const auto rank = std::clamp( static_cast<std::uint64_t>( std::ceil( std::clamp( percentile, 0.0, 100.0 ) / 100.0 * this->m_count ) ),
+                                  std::uint64_t { 1 }, this->m_count );
+    std::uint64_t seen = 0;
+    for( std::size_t bucket = 0; bucket < this->m_counts.size(); ++bucket ) {
+        seen += this->m_counts[ bucket ];
+        if( seen >= rank ) {
+            return std::chrono::nanoseconds { std::min( HighestValueOf( bucket ), this->m_max ) };
+        }
+    }
+    return Max();
+}
+
+auto Histogram::Add( std::size_t bucket, std::uint64_t count ) -> void {
+    if( this->m_counts.empty() ) {
+        this->m_counts.resize( BUCKETS, 0 );
+    }
+    this->m_counts[ bucket ] += count;
+    this->m_count += count;
+}
+
+}
@@ -0,0 +1,390 @@
+#include "Coroutines/IoUringContext.h"
+
+#ifdef __linux__
+
+#include "Coroutines/Private/Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Coroutines {
+
+namespace {
+    // user_data of the read that wakes the loop and of the cancellation on destruction,
+    // operations are never at address 0 or 1.
+    constexpr std::uint64_t WAKEUP_USER_DATA = 0;
+    constexpr std::uint64_t CANCEL_USER_DATA = 1;
+
+    auto MakeSqe( std::uint8_t opcode, int fd, const void* address, std::size_t length, std::uint64_t offset ) noexcept -> io_uring_sqe {
+        io_uring_sqe sqe {};
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>( address );
+        sqe.len = static_cast<std::uint32_t>( std::min<std::size_t>( length, std::numeric_limits<std::uint32_t>::max() ) );
+        sqe.off = offset;
+        return sqe;
+    }
+
+    template<typename T>
+    auto RingField( void* ring, std::uint32_t offset ) noexcept -> T* {
+        return reinterpret_cast<T*>( static_cast<std::byte*>( ring ) + offset );
+    }
+}
+
+thread_local IoUringContext* IoUringContext::s_currentContext = nullptr;
+
+auto IoUringContext::IoOperation::Result() const -> std::int32_t {
+    if( this->m_result < 0 ) {
+        throw std::system_error( -this->m_result, std::system_category(), this->m_what );
+    }
+    return this->m_result;
+}
+
+IoUringContext::IoUringContext( options opts )
+    : m_inbox( opts.inbox_capacity ) {
+    io_uring_params params {};
+    this->m_ringFd = static_cast<int>( ::syscall( __NR_io_uring_setup, opts.queue_depth, &params ) );
+    if( this->m_ringFd < 0 ) {
+        throw std::runtime_error( "Coroutines::IoUringContext unable to set up an io_uring instance." );
+    }
+    if( ( params.features & IORING_FEAT_NODROP ) == 0 ) {
+        Release();
+        throw std::runtime_error( "Coroutines::IoUringContext needs a kernel that never drops completions." );
+    }
+
+    this->m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    this->m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+    const bool singleMap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+    if( singleMap ) {
+        this->m_sqRingSize = std::max( this->m_sqRingSize, this->m_cqRingSize );
+        this->m_cqRingSize = 0;
+    }
+
+    this->m_sqRing = ::mmap( nullptr, this->m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_ringFd, IORING_OFF_SQ_RING );
+    if( this->m_sqRing == MAP_FAILED ) {
+        this->m_sqRing = nullptr;
+        Release();
+        throw std::runtime_error( "Coroutines::IoUringContext unable to map the submission queue." );
+    }
+    this->m_cqRing = this->m_sqRing;
+    if( !singleMap ) {
+        this->m_cqRing = ::mmap( nullptr, this->m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_ringFd, IORING_OFF_CQ_RING );
+        if( this->m_cqRing == MAP_FAILED ) {
+            this->m_cqRing = nullptr;
+            Release();
+            throw std::runtime_error( "Coroutines::IoUringContext unable to map the completion queue." );
+        }
+    }
+
+    this->m_sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+    auto* sqes = ::mmap( nullptr, this->m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_ringFd, IORING_OFF_SQES );
+    if( sqes == MAP_FAILED ) {
+        Release();
+        throw std::runtime_error( "Coroutines::IoUringContext unable to map the submission queue entries." );
+    }
+    this->m_sqes = static_cast<io_uring_sqe*>( sqes );
+
+    this->m_sqHead = RingField<unsigned>( this->m_sqRing, params.sq_off.head );
+    this->m_sqTail = RingField<unsigned>( this->m_sqRing, params.sq_off.tail );
+    this->m_sqArray = RingField<unsigned>( this->m_sqRing, params.sq_off.array );
+    this->m_sqMask = *RingField<unsigned>( this->m_sqRing, params.sq_off.ring_mask );
+    this->m_sqEntries = *RingField<unsigned>( this->m_sqRing, params.sq_off.ring_entries );
+    this->m_cqHead = RingField<unsigned>( this->m_cqRing, params.cq_off.head );
+    this->m_cqTail = RingField<unsigned>( this->m_cqRing, params.cq_off.tail );
+    this->m_cqes = RingField<io_uring_cqe>( this->m_cqRing, params.cq_off.cqes );
+    this->m_cqMask = *RingField<unsigned>( this->m_cqRing, params.cq_off.ring_mask );
+
+    this->m_eventFd = ::eventfd( 0, EFD_CLOEXEC );
+    if( this->m_eventFd < 0 ) {
+        Release();
+        throw std::runtime_error( "Coroutines::IoUringContext unable to create an eventfd." );
+    }
+
+    if( opts.registered_buffers > 0 && opts.registered_buffer_size > 0 ) {
+        this->m_bufferCount = opts.registered_buffers;
+        this->m_bufferSize = opts.registered_buffer_size;
+        this->m_buffers = std::make_unique<std::byte[]>( this->m_bufferCount * this->m_bufferSize );
+
+        std::vector<iovec> iovecs( this->m_bufferCount );
+        for( std::size_t i = 0; i < this->m_bufferCount; ++i ) {
+            iovecs[ i ].iov_base = this->m_buffers.get() + i * this->m_bufferSize;
+            iovecs[ i ].iov_len = this->m_bufferSize;
+        }
+        if( ::syscall( __NR_io_uring_register, this->m_ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>( iovecs.size() ) ) < 0 ) {
+            Release();
+            throw std::runtime_error( "Coroutines::IoUringContext unable to register buffers, check RLIMIT_MEMLOCK." );
+        }
+    }
+}
+
+IoUringContext::~IoUringContext() {
+    // The kernel may still write into the buffers of operations in flight, e.g. reads of a
+    // pipe nobody writes to. Cancel them all and wait for their completions without resuming
+    // their coroutines.
+    if( this->m_inFlight > 0 ) {
+        auto sqe = MakeSqe( IORING_OP_ASYNC_CANCEL, -1, nullptr, 0, 0 );
+        sqe.cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        sqe.user_data = CANCEL_USER_DATA;
+        Prepare( sqe );
+    }
+    while( this->m_inFlight > 0 ) {
+        const auto submitted = ::syscall( __NR_io_uring_enter, this->m_ringFd, this->m_toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+        if( submitted > 0 ) {
+            this->m_toSubmit -= static_cast<unsigned>( submitted );
+        } else if( submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY ) {
+            break;
+        }
+        Reap();
+    }
+    this->m_localQueue.clear();
+    Release();
+}
+
+auto IoUringContext::Release() noexcept -> void {
+    if( this->m_sqes != nullptr ) {
+        ::munmap( this->m_sqes, this->m_sqesSize );
+    }
+    if( this->m_cqRing != nullptr && this->m_cqRing != this->m_sqRing ) {
+        ::munmap( this->m_cqRing, this->m_cqRingSize );
+    }
+    if( this->m_sqRing != nullptr ) {
+        ::munmap( this->m_sqRing, this->m_sqRingSize );
+    }
+    if( this->m_eventFd >= 0 ) {
+        ::close( this->m_eventFd );
+    }
+    if( this->m_ringFd >= 0 ) {
+        ::close( this->m_ringFd );
+    }
+}
+
+auto IoUringContext::resume( std::coroutine_handle<> handle ) noexcept -> void {
+    if( handle == nullptr ) {
+        return;
+    }
+
+    if( IsLoopThread() ) {
+        this->m_localQueue.emplace_back( handle );
+        return;
+    }
+
+    this->m_inbox.Push( handle );
+    Notify();
+}
+
+auto IoUringContext::Read( int fd, std::span<std::byte> buffer, std::uint64_t offset ) noexcept -> TransferOperation {
+    return TransferOperation( *this, "Coroutines::IoUringContext::Read", MakeSqe( IORING_OP_READ, fd, buffer.data(), buffer.size(), offset ) );
+}
+
+auto IoUringContext::Write( int fd, std::span<const std::byte> buffer, std::uint64_t offset ) noexcept -> TransferOperation {
+    return TransferOperation( *this, "Coroutines::IoUringContext::Write", MakeSqe( IORING_OP_WRITE, fd, buffer.data(), buffer.size(), offset ) );
+}
+
+auto IoUringContext::ReadFixed( int fd, std::size_t index, std::size_t length, std::uint64_t offset ) noexcept -> TransferOperation {
+    if( index >= this->m_bufferCount ) {
+        return TransferOperation( *this, "Coroutines::IoUringContext::ReadFixed", -EINVAL );
+    }
+    // The kernel registers fewer buffers than buf_index can address.
+    auto sqe = MakeSqe( IORING_OP_READ_FIXED, fd, RegisteredBuffer( index ).data(), std::min( length, this->m_bufferSize ), offset );
+    sqe.buf_index = static_cast<std::uint16_t>( index );
+    return TransferOperation( *this, "Coroutines::IoUringContext::ReadFixed", sqe );
+}
+
+auto IoUringContext::WriteFixed( int fd, std::size_t index, std::size_t length, std::uint64_t offset ) noexcept -> TransferOperation {
+    if( index >= this->m_bufferCount ) {
+        return TransferOperation( *this, "Coroutines::IoUringContext::WriteFixed", -EINVAL );
+    }
+    auto sqe = MakeSqe( IORING_OP_WRITE_FIXED, fd, RegisteredBuffer( index ).data(), std::min( length, this->m_bufferSize ), offset );
+    sqe.buf_index = static_cast<std::uint16_t>( index );
+    return TransferOperation( *this, "Coroutines::IoUringContext::WriteFixed", sqe );
+}
+
+auto IoUringContext::Fsync( int fd, bool data_only ) noexcept -> SyncOperation {
+    auto sqe = MakeSqe( IORING_OP_FSYNC, fd, nullptr, 0, 0 );
+    sqe.fsync_flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+    return SyncOperation( *this, "Coroutines::IoUringContext::Fsync", sqe );
+}
+
+auto IoUringContext::Openat( int dir_fd, const char* path, int flags, mode_t mode ) noexcept -> OpenOperation {
+    auto sqe = MakeSqe( IORING_OP_OPENAT, dir_fd, path, mode, 0 );
+    sqe.open_flags = static_cast<std::uint32_t>( flags );
+    return OpenOperation( *this, "Coroutines::IoUringContext::Openat", sqe );
+}
+
+auto IoUringContext::Submit( IoOperation& operation ) noexcept -> void {
+    operation.m_sqe.user_data = reinterpret_cast<std::uint64_t>( &operation );
+    if( IsLoopThread() ) {
+        ++this->m_inFlight;
+        Prepare( operation.m_sqe );
+        return;
+    }
+
+    auto* head = this->m_remoteOperations.load( std::memory_order::relaxed );
+    do {
+        operation.m_next = head;
+    } while( !this->m_remoteOperations.compare_exchange_weak( head, &operation, std::memory_order::release, std::memory_order::relaxed ) );
+    Notify();
+}
+
+auto IoUringContext::Prepare( const io_uring_sqe& sqe ) noexcept -> void {
+    const auto tail = *this->m_sqTail;
+    while( tail - std::atomic_ref { *this->m_sqHead }.load( std::memory_order::acquire ) == this->m_sqEntries ) {
+        // Full, hand the queue over early.
+        const auto submitted = ::syscall( __NR_io_uring_enter, this->m_ringFd, this->m_toSubmit, 0, 0, nullptr, 0 );
+        if( submitted > 0 ) {
+            this->m_toSubmit -= static_cast<unsigned>( submitted );
+            continue;
+        }
+
+        // The kernel refuses while completions back up, block until one arrives and make room.
+        const auto waited = ::syscall( __NR_io_uring_enter, this->m_ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+        if( waited < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY ) {
+            // Nothing can be submitted to this ring anymore.
+            std::terminate();
+        }
+        Reap();
+    }
+
+    const auto index = tail & this->m_sqMask;
+    this->m_sqes[ index ] = sqe;
+    this->m_sqArray[ index ] = index;
+    std::atomic_ref { *this->m_sqTail }.store( tail + 1, std::memory_order::release );
+    ++this->m_toSubmit;
+}
+
+auto IoUringContext::ArmWakeup() noexcept -> void {
+    auto sqe = MakeSqe( IORING_OP_READ, this->m_eventFd, &this->m_wakeupValue, sizeof( this->m_wakeupValue ), 0 );
+    sqe.user_data = WAKEUP_USER_DATA;
+    Prepare( sqe );
+    this->m_wakeupArmed = true;
+}
+
+auto IoUringContext::DrainInbox() noexcept -> void {
+    std::int64_t stamp = 0;
+    while( auto handle = this->m_inbox.Pop( stamp ) ) {
+        this->m_localQueue.emplace_back( handle );
+    }
+
+    // The stack holds the newest first, submit in arrival order.
+    IoOperation* reversed = nullptr;
+    auto* operation = this->m_remoteOperations.exchange( nullptr, std::memory_order::acquire );
+    while( operation != nullptr ) {
+        auto* next = operation->m_next;
+        operation->m_next = reversed;
+        reversed = operation;
+        operation = next;
+    }
+
+    for( operation = reversed; operation != nullptr; operation = operation->m_next ) {
+        ++this->m_inFlight;
+        Prepare( operation->m_sqe );
+    }
+}
+
+auto IoUringContext::RunRound() -> std::size_t {
+    auto* previous = std::exchange( s_currentContext, this );
+    DrainInbox();
+
+    // Handles queued meanwhile wait for the next round, after the kernel had its turn.
+    std::size_t resumed = 0;
+    for( auto count = this->m_localQueue.size(); count > 0; --count ) {
+        auto handle = this->m_localQueue.front();
+        this->m_localQueue.pop_front();
+
+        COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+        handle.resume();
+        COROUTINES_TRACE_RESUME_END( handle.address() );
+        ++resumed;
+    }
+
+    s_currentContext = previous;
+    return resumed;
+}
+
+auto IoUringContext::RunUntilIdle() -> std::size_t {
+    std::size_t resumed = 0;
+    while( true ) {
+        resumed += RunRound();
+        if( this->m_localQueue.empty() && this->m_inFlight == 0 && this->m_inbox.empty() && this->m_remoteOperations.load( std::memory_order::acquire ) == nullptr ) {
+            break;
+        }
+        Enter( this->m_localQueue.empty() );
+    }
+    return resumed;
+}
+
+auto IoUringContext::Enter( bool wait ) -> void {
+    if( wait ) {
+        if( !this->m_wakeupArmed ) {
+            ArmWakeup();
+        }
+
+        // Pairs with Notify(): either the loop sees the submission or the submitter sees the loop sleeping.
+        this->m_sleeping.store( true, std::memory_order::seq_cst );
+        std::atomic_thread_fence( std::memory_order::seq_cst );
+        if( !this->m_inbox.empty() || this->m_remoteOperations.load( std::memory_order::relaxed ) != nullptr ) {
+            wait = false;
+        }
+    }
+
+    if( wait || this->m_toSubmit > 0 ) {
+        const auto flags = wait ? IORING_ENTER_GETEVENTS : 0u;
+        const auto submitted = ::syscall( __NR_io_uring_enter, this->m_ringFd, this->m_toSubmit, wait ? 1 : 0, flags, nullptr, 0 );
+        if( submitted >= 0 ) {
+            this->m_toSubmit -= static_cast<unsigned>( submitted );
+        } else if( errno != EINTR && errno != EAGAIN && errno != EBUSY ) {
+            this->m_sleeping.store( false, std::memory_order::relaxed );
+            throw std::system_error( errno, std::system_category(), "Coroutines::IoUringContext io_uring_enter" );
+        }
+    }
+
+    this->m_sleeping.store( false, std::memory_order::relaxed );
+    Reap();
+}
+
+auto IoUringContext::Reap() noexcept -> void {
+    auto head = *this->m_cqHead;
+    const auto tail = std::atomic_ref { *this->m_cqTail }.load( std::memory_order::acquire );
+    for( ; head != tail; ++head ) {
+        const auto& cqe = this->m_cqes[ head & this->m_cqMask ];
+        if( cqe.user_data == WAKEUP_USER_DATA ) {
+            this->m_wakeupArmed = false;
+            continue;
+        }
+        if( cqe.user_data == CANCEL_USER_DATA ) {
+            continue;
+        }
+
+        auto* operation = reinterpret_cast<IoOperation*>( cqe.user_data );
+        operation->m_result = cqe.res;
+        --this->m_inFlight;
+        this->m_localQueue.emplace_back( operation->m_awaitingCoroutine );
+    }
+    std::atomic_ref { *this->m_cqHead }.store( head, std::memory_order::release );
+}
+
+auto IoUringContext::Notify() noexcept -> void {
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+    if( !this->m_sleeping.load( std::memory_order::relaxed ) || !this->m_sleeping.exchange( false, std::memory_order::acq_rel ) ) {
+        return;
+    }
+
+    const std::uint64_t value = 1;
+    while( ::write( this->m_eventFd, &value, sizeof( value ) ) < 0 && errno == EINTR ) {
+    }
+}
+
+}
+
+#endif
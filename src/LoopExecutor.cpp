@@ -0,0 +1,120 @@
+#include "Coroutines/LoopExecutor.h"
+
+#include "Coroutines/Private/Trace.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace Coroutines {
+
+thread_local LoopExecutor* LoopExecutor::s_currentLoop = nullptr;
+
+LoopExecutor::LoopExecutor( options opts )
+    : m_inbox( opts.inbox_capacity ) {
+#ifdef __linux__
+    this->m_eventFd = ::eventfd( 0, EFD_CLOEXEC );
+    if( this->m_eventFd < 0 ) {
+        throw std::runtime_error( "Coroutines::LoopExecutor unable to create an eventfd." );
+    }
+#endif
+}
+
+LoopExecutor::~LoopExecutor() {
+#ifdef __linux__
+    ::close( this->m_eventFd );
+#endif
+}
+
+auto LoopExecutor::resume( std::coroutine_handle<> handle ) noexcept -> void {
+    if( handle == nullptr ) {
+        return;
+    }
+
+    if( IsLoopThread() ) {
+        this->m_localQueue.emplace_back( handle );
+        return;
+    }
+
+    this->m_inbox.Push( handle );
+
+    // Pairs with Wait(): either the loop sees the handle or this sees the loop sleeping.
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+    if( this->m_sleeping.load( std::memory_order::relaxed ) && this->m_sleeping.exchange( false, std::memory_order::acq_rel ) ) {
+        Notify();
+    }
+}
+
+auto LoopExecutor::RunUntilIdle() -> std::size_t {
+    auto* previous = std::exchange( s_currentLoop, this );
+    std::size_t resumed = 0;
+    while( true ) {
+        DrainInbox();
+        if( this->m_localQueue.empty() ) {
+            break;
+        }
+
+        // One round at a time, handles queued meanwhile wait behind the inbox.
+        for( auto count = this->m_localQueue.size(); count > 0; --count ) {
+            auto handle = this->m_localQueue.front();
+            this->m_localQueue.pop_front();
+
+            COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+            handle.resume();
+            COROUTINES_TRACE_RESUME_END( handle.address() );
+            ++resumed;
+        }
+    }
+
+    s_currentLoop = previous;
+    return resumed;
+}
+
+auto LoopExecutor::DrainInbox() noexcept -> void {
+    std::int64_t stamp = 0;
+    while( auto handle = this->m_inbox.Pop( stamp ) ) {
+        this->m_localQueue.emplace_back( handle );
+    }
+}
+
+auto LoopExecutor::Wait() -> void {
+    // Pairs with the fence in resume(): the inbox is read after the store is visible.
+    this->m_sleeping.store( true, std::memory_order::seq_cst );
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+    if( !this->m_inbox.empty() ) {
+        this->m_sleeping.store( false, std::memory_order::relaxed );
+        return;
+    }
+
+#ifdef __linux__
+    std::uint64_t value = 0;
+    while( ::read( this->m_eventFd, &value, sizeof( value ) ) < 0 && errno == EINTR ) {
+    }
+#else
+    std::unique_lock lk { this->m_wakeMutex };
+    this->m_wakeCv.wait( lk, [ this ] { return this->m_wakeup; } );
+    this->m_wakeup = false;
+#endif
+    this->m_sleeping.store( false, std::memory_order::relaxed );
+}
+
+auto LoopExecutor::Notify() noexcept -> void {
+#ifdef __linux__
+    const std::uint64_t value = 1;
+    while( ::write( this->m_eventFd, &value, sizeof( value ) ) < 0 && errno == EINTR ) {
+    }
+#else
+    {
+        std::scoped_lock lk { this->m_wakeMutex };
+        this->m_wakeup = true;
+    }
+    this->m_wakeCv.notify_one();
+#endif
+}
+
+}
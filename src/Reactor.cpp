@@ -0,0 +1,232 @@
+#include "Coroutines/Reactor.h"
+
+#ifdef __linux__
+
+#include "Coroutines/Private/Trace.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace Coroutines {
+
+Reactor::Reactor( std::shared_ptr<ThreadPool> tp, options opts )
+    : m_threadPool( std::move( tp ) )
+    , m_opts( opts )
+    , m_inbox( opts.inbox_capacity ) {
+    this->m_epollFd = ::epoll_create1( EPOLL_CLOEXEC );
+    if( this->m_epollFd < 0 ) {
+        throw std::runtime_error( "Coroutines::Reactor unable to create an epoll instance." );
+    }
+
+    this->m_eventFd = ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    if( this->m_eventFd < 0 ) {
+        ::close( this->m_epollFd );
+        throw std::runtime_error( "Coroutines::Reactor unable to create an eventfd." );
+    }
+
+    // Level-triggered, the reactor drains it on every wakeup.
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if( ::epoll_ctl( this->m_epollFd, EPOLL_CTL_ADD, this->m_eventFd, &event ) < 0 ) {
+        ::close( this->m_eventFd );
+        ::close( this->m_epollFd );
+        throw std::runtime_error( "Coroutines::Reactor unable to watch its eventfd." );
+    }
+
+    this->m_thread = std::jthread { [ this ]( std::stop_token stop_token ) { Run( stop_token ); } };
+}
+
+Reactor::~Reactor() {
+    this->m_thread.request_stop();
+    Wake();
+    this->m_thread.join();
+
+    ::close( this->m_eventFd );
+    ::close( this->m_epollFd );
+}
+
+auto Reactor::resume( std::coroutine_handle<> handle ) noexcept -> void {
+    if( handle == nullptr ) {
+        return;
+    }
+
+    this->m_inbox.Push( handle );
+    Notify();
+}
+
+auto Reactor::Readable( int fd ) -> ReadinessOperation {
+    return ReadinessOperation { Register( fd ).m_readable };
+}
+
+auto Reactor::Writable( int fd ) -> ReadinessOperation {
+    return ReadinessOperation { Register( fd ).m_writable };
+}
+
+auto Reactor::Register( int fd ) -> Registration& {
+    std::scoped_lock lk { this->m_registrationsMutex };
+    auto& registration = this->m_registrations[ fd ];
+    if( registration != nullptr ) {
+        return *registration;
+    }
+
+    auto added = std::make_unique<Registration>();
+    added->m_fd = fd;
+
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = added.get();
+    if( ::epoll_ctl( this->m_epollFd, EPOLL_CTL_ADD, fd, &event ) < 0 ) {
+        const auto error = errno;
+        this->m_registrations.erase( fd );
+        throw std::system_error( error, std::system_category(), "Coroutines::Reactor unable to watch the file descriptor" );
+    }
+
+    registration = std::move( added );
+    return *registration;
+}
+
+auto Reactor::Remove( int fd ) -> void {
+    std::vector<std::coroutine_handle<>> waiters;
+    {
+        std::scoped_lock lk { this->m_registrationsMutex };
+        auto it = this->m_registrations.find( fd );
+        if( it == this->m_registrations.end() ) {
+            return;
+        }
+
+        ::epoll_ctl( this->m_epollFd, EPOLL_CTL_DEL, fd, nullptr );
+        for( auto* readiness: { &it->second->m_readable, &it->second->m_writable } ) {
+            if( auto handle = Signal( *readiness ) ) {
+                waiters.emplace_back( handle );
+            }
+        }
+        this->m_retired.emplace_back( std::move( it->second ) );
+        this->m_registrations.erase( it );
+    }
+
+    if( waiters.empty() ) {
+        return;
+    }
+    if( this->m_threadPool != nullptr ) {
+        this->m_threadPool->resume( waiters );
+    } else {
+        for( auto handle: waiters ) {
+            resume( handle );
+        }
+    }
+}
+
+auto Reactor::Signal( Readiness& readiness ) noexcept -> std::coroutine_handle<> {
+    auto state = readiness.m_state.load( std::memory_order::acquire );
+    while( state != Readiness::READY ) {
+        // A waiter takes the readiness along, otherwise it is kept for the next await.
+        const auto desired = state == 0 ? Readiness::READY : 0;
+        if( readiness.m_state.compare_exchange_weak( state, desired, std::memory_order::acq_rel, std::memory_order::acquire ) ) {
+            return state == 0 ? nullptr : std::coroutine_handle<>::from_address( reinterpret_cast<void*>( state ) );
+        }
+    }
+    return nullptr;
+}
+
+auto Reactor::Run( std::stop_token stop_token ) -> void {
+    std::vector<epoll_event> events( this->m_opts.max_events );
+    std::vector<std::coroutine_handle<>> ready;
+
+    while( !stop_token.stop_requested() ) {
+        {
+            std::scoped_lock lk { this->m_registrationsMutex };
+            this->m_retired.clear();
+        }
+        RunInbox();
+
+        // Pairs with Notify(): either the reactor sees the handle or the submitter sees it sleeping.
+        this->m_sleeping.store( true, std::memory_order::seq_cst );
+        std::atomic_thread_fence( std::memory_order::seq_cst );
+        const auto timeout = this->m_inbox.empty() && !stop_token.stop_requested() ? -1 : 0;
+        const auto count = ::epoll_wait( this->m_epollFd, events.data(), static_cast<int>( events.size() ), timeout );
+        this->m_sleeping.store( false, std::memory_order::relaxed );
+        if( count < 0 ) {
+            continue;
+        }
+
+        for( int i = 0; i < count; ++i ) {
+            const auto& event = events[ i ];
+            if( event.data.ptr == nullptr ) {
+                std::uint64_t value = 0;
+                while( ::read( this->m_eventFd, &value, sizeof( value ) ) < 0 && errno == EINTR ) {
+                }
+                continue;
+            }
+
+            auto& registration = *static_cast<Registration*>( event.data.ptr );
+            if( event.events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) ) {
+                if( auto handle = Signal( registration.m_readable ) ) {
+                    ready.emplace_back( handle );
+                }
+            }
+            if( event.events & ( EPOLLOUT | EPOLLHUP | EPOLLERR ) ) {
+                if( auto handle = Signal( registration.m_writable ) ) {
+                    ready.emplace_back( handle );
+                }
+            }
+        }
+
+        if( ready.empty() ) {
+            continue;
+        }
+
+        if( this->m_threadPool != nullptr ) {
+            this->m_threadPool->resume( ready );
+        } else {
+            for( auto handle: ready ) {
+                COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+                handle.resume();
+                COROUTINES_TRACE_RESUME_END( handle.address() );
+            }
+        }
+        ready.clear();
+    }
+
+    // Keep running what was resumed before the stop request until nothing is left.
+    while( !this->m_inbox.empty() ) {
+        RunInbox();
+    }
+}
+
+auto Reactor::RunInbox() -> void {
+    // Handles queued while these run wait for the next round, after epoll had its turn.
+    std::vector<std::coroutine_handle<>> batch;
+    std::int64_t stamp = 0;
+    while( auto handle = this->m_inbox.Pop( stamp ) ) {
+        batch.emplace_back( handle );
+    }
+
+    for( auto handle: batch ) {
+        COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+        handle.resume();
+        COROUTINES_TRACE_RESUME_END( handle.address() );
+    }
+}
+
+auto Reactor::Notify() noexcept -> void {
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+    if( this->m_sleeping.load( std::memory_order::relaxed ) && this->m_sleeping.exchange( false, std::memory_order::acq_rel ) ) {
+        Wake();
+    }
+}
+
+auto Reactor::Wake() noexcept -> void {
+    const std::uint64_t value = 1;
+    while( ::write( this->m_eventFd, &value, sizeof( value ) ) < 0 && errno == EINTR ) {
+    }
+}
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "Coroutines/Semaphore.h"
 
+#include "Coroutines/Private/CooperativeBudget.h"
+
 
 namespace Coroutines {
 Semaphore::Semaphore( std::ptrdiff_t least_max_value_and_starting_value )
@@ -19,34 +21,66 @@ Semaphore::AcquireOperation::AcquireOperation( Semaphore& s )
     : m_semaphore( s ) {
 }
 
-auto Semaphore::AcquireOperation::await_ready() const noexcept -> bool {
+auto Semaphore::AcquireOperation::await_ready() noexcept -> bool {
     if( this->m_semaphore.m_notify_all_set.load( std::memory_order::relaxed ) ) {
-        return true;
+        // Out of budget, await_suspend() reschedules.
+        return Private::CooperativeBudget::Consume();
+    }
+
+    if( !this->m_semaphore.TryAcquire() ) {
+        return false;
     }
-    return this->m_semaphore.TryAcquire();
+    // Out of budget, await_suspend() reschedules with the unit acquired.
+    this->m_acquired = true;
+    return Private::CooperativeBudget::Consume();
 }
 
 auto Semaphore::AcquireOperation::await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
+    if( this->m_acquired ) {
+        Private::CooperativeBudget::Reschedule( awaiting_coroutine );
+        return true;
+    }
+
     std::unique_lock lk { this->m_semaphore.m_waiterMutex };
     if( this->m_semaphore.m_notify_all_set.load( std::memory_order::relaxed ) ) {
-        return false;
+        lk.unlock();
+        return Private::CooperativeBudget::YieldIfExhausted( awaiting_coroutine );
     }
 
     if( this->m_semaphore.TryAcquire() ) {
-        return false;
+        lk.unlock();
+        return Private::CooperativeBudget::YieldIfExhausted( awaiting_coroutine );
     }
 
-    if( this->m_semaphore.m_acquireWaiters == nullptr ) {
-        this->m_semaphore.m_acquireWaiters = this;
-    } else {
-        this->m_next = this->m_semaphore.m_acquireWaiters;
-        this->m_semaphore.m_acquireWaiters = this;
+    this->m_next = this->m_semaphore.m_acquireWaiters;
+    if( this->m_next != nullptr ) {
+        this->m_next->m_prev = this;
     }
+    this->m_semaphore.m_acquireWaiters = this;
+    this->m_waiting = true;
 
     this->m_awaiting_coroutine = awaiting_coroutine;
     return true;
 }
 
+auto Semaphore::AcquireOperation::Abandon() noexcept -> bool {
+    std::unique_lock lk { this->m_semaphore.m_waiterMutex };
+    if( !this->m_waiting ) {
+        return false;
+    }
+
+    if( this->m_prev != nullptr ) {
+        this->m_prev->m_next = this->m_next;
+    } else {
+        this->m_semaphore.m_acquireWaiters = this->m_next;
+    }
+    if( this->m_next != nullptr ) {
+        this->m_next->m_prev = this->m_prev;
+    }
+    this->m_waiting = false;
+    return true;
+}
+
 auto Semaphore::AcquireOperation::await_resume() const -> void {
     if( this->m_semaphore.m_notify_all_set.load( std::memory_order::relaxed ) ) {
         throw Coroutines::StopSignal {};
@@ -55,9 +89,7 @@ auto Semaphore::AcquireOperation::await_resume() const -> void {
 
 auto Semaphore::Release() -> void {
     std::unique_lock lk { this->m_waiterMutex };
-    if( this->m_acquireWaiters != nullptr ) {
-        AcquireOperation* to_resume = this->m_acquireWaiters;
-        this->m_acquireWaiters = this->m_acquireWaiters->m_next;
+    if( AcquireOperation* to_resume = PopWaiter(); to_resume != nullptr ) {
         lk.unlock();
         to_resume->m_awaiting_coroutine.resume();
     } else {
@@ -65,6 +97,18 @@ auto Semaphore::Release() -> void {
     }
 }
 
+auto Semaphore::PopWaiter() noexcept -> AcquireOperation* {
+    AcquireOperation* waiter = this->m_acquireWaiters;
+    if( waiter != nullptr ) {
+        this->m_acquireWaiters = waiter->m_next;
+        if( this->m_acquireWaiters != nullptr ) {
+            this->m_acquireWaiters->m_prev = nullptr;
+        }
+        waiter->m_waiting = false;
+    }
+    return waiter;
+}
+
 auto Semaphore::TryAcquire() -> bool {
     auto previous = this->m_counter.fetch_sub( 1, std::memory_order::acq_rel );
     if( previous <= 0 ) {
@@ -78,9 +122,7 @@ auto Semaphore::StopSignalNotifyWaiters() noexcept -> void {
     this->m_notify_all_set.exchange( true, std::memory_order::release );
     while( true ) {
         std::unique_lock lk { this->m_waiterMutex };
-        if( this->m_acquireWaiters != nullptr ) {
-            AcquireOperation* to_resume = this->m_acquireWaiters;
-            this->m_acquireWaiters = this->m_acquireWaiters->m_next;
+        if( AcquireOperation* to_resume = PopWaiter(); to_resume != nullptr ) {
             lk.unlock();
 
             to_resume->m_awaiting_coroutine.resume();
@@ -6,11 +6,9 @@ SyncWaitEvent::SyncWaitEvent( bool initially_set )
 }
 
 auto SyncWaitEvent::Set() noexcept -> void {
-    {
-        std::lock_guard<std::mutex> g { this->m_mutex };
-        this->m_set = true;
-    }
-
+    // Notified under the lock, the waiter destroys the event as soon as it sees m_set.
+    std::lock_guard<std::mutex> g { this->m_mutex };
+    this->m_set = true;
     m_cv.notify_all();
 }
 
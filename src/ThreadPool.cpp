@@ -1,23 +1,169 @@
 #include "Coroutines/ThreadPool.h"
 
+#include "Coroutines/Private/CooperativeBudget.h"
+#include "Coroutines/Private/CpuTopology.h"
+#include "Coroutines/Private/Trace.h"
+
+#include <algorithm>
 #include <iostream>
 
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ )
+#include <immintrin.h>
+#endif
+
 namespace Coroutines {
-ThreadPool::Operation::Operation( ThreadPool& tp ) noexcept
-    : m_threadPool( tp ) {
+namespace {
+    auto CpuRelax() noexcept -> void {
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ )
+        _mm_pause();
+#elif defined( __aarch64__ )
+        asm volatile( "yield" );
+#endif
+    }
+
+    // Never 0, which marks a handle that was not timestamped.
+    auto NowNs() noexcept -> std::int64_t {
+        const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+        return now != 0 ? now : 1;
+    }
+}
+
+thread_local ThreadPool::Worker* ThreadPool::s_currentWorker = nullptr;
+
+ThreadPool::Operation::Operation( ThreadPool& tp, SchedulePriority priority, bool yield, bool resumeInline ) noexcept
+    : m_threadPool( tp )
+    , m_priority( priority )
+    , m_yield( yield )
+    , m_inline( resumeInline ) {
 }
 
 auto ThreadPool::Operation::await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> void {
     this->m_awaitingCoroutine = awaiting_coroutine;
-    this->m_threadPool.ScheduleImpl( this->m_awaitingCoroutine );
+    this->m_threadPool.ScheduleImpl( this->m_awaitingCoroutine, this->m_priority, this->m_yield );
+}
+
+ThreadPool::TimerOperation::TimerOperation( ThreadPool& tp, std::chrono::steady_clock::time_point deadline ) noexcept
+    : m_threadPool( tp )
+    , m_deadline( deadline ) {
+}
+
+auto ThreadPool::TimerOperation::await_suspend( std::coroutine_handle<> awaiting_coroutine ) noexcept -> bool {
+    this->m_awaitingCoroutine = awaiting_coroutine;
+    this->m_tick = Private::TimerWheel::DeadlineTick( this->m_deadline );
+    this->m_fire = &TimerOperation::Fire;
+    if( !this->m_threadPool.AddTimer( *this ) ) {
+        this->m_expired = false;
+        return false;
+    }
+
+    return true;
+}
+
+auto ThreadPool::TimerOperation::Cancel() noexcept -> bool {
+    return this->m_threadPool.CancelTimer( *this );
+}
+
+auto ThreadPool::TimerOperation::Fire( Private::TimerNode& node, bool expired ) noexcept -> std::coroutine_handle<> {
+    auto& operation = static_cast<TimerOperation&>( node );
+    operation.m_expired = expired;
+    return operation.m_awaitingCoroutine;
 }
 
 ThreadPool::ThreadPool( options opts )
     : m_opts( std::move( opts ) ) {
-    this->m_threads.reserve( this->m_opts.thread_count );
+    const auto count = this->m_opts.thread_count;
+    if( this->m_opts.elastic && this->m_opts.elastic->min_thread_count > count ) {
+        throw std::runtime_error( "Coroutines::ThreadPool elastic min_thread_count exceeds thread_count." );
+    }
+
+    std::vector<std::vector<uint32_t>> workerCpus( count );
+    std::vector<std::size_t> workerNodes( count, 0 );
+
+    if( this->m_opts.affinity != thread_affinity::none ) {
+        const auto topology = Private::CpuTopology::Read();
+        for( uint32_t i = 0; i < count; ++i ) {
+            switch( this->m_opts.affinity ) {
+                case thread_affinity::cpu_list:
+                    if( this->m_opts.affinity_cpus.empty() ) {
+                        throw std::runtime_error( "Coroutines::ThreadPool thread_affinity::cpu_list requires affinity_cpus." );
+                    }
+                    workerCpus[ i ] = { this->m_opts.affinity_cpus[ i % this->m_opts.affinity_cpus.size() ] };
+                    break;
+                case thread_affinity::one_per_core:
+                    workerCpus[ i ] = { topology.m_cores[ i % topology.m_cores.size() ] };
+                    break;
+                case thread_affinity::per_numa_node:
+                    workerCpus[ i ] = topology.m_nodes[ i % topology.m_nodes.size() ];
+                    break;
+                case thread_affinity::none:
+                    break;
+            }
+            workerNodes[ i ] = topology.NodeOf( workerCpus[ i ].front() );
+        }
+
+        // Only nodes that host workers get a scheduling node, numbered in topology order.
+        std::vector<std::size_t> topologyToNode( topology.m_nodes.size(), 0 );
+        std::vector<bool> used( topology.m_nodes.size(), false );
+        for( auto node: workerNodes ) {
+            used[ node ] = true;
+        }
+
+        std::size_t nodes = 0;
+        for( std::size_t i = 0; i < used.size(); ++i ) {
+            topologyToNode[ i ] = used[ i ] ? nodes++ : 0;
+        }
+        for( std::size_t i = 0; i < used.size(); ++i ) {
+            if( !used[ i ] ) {
+                topologyToNode[ i ] = i % nodes;
+            }
+        }
+
+        for( auto& node: workerNodes ) {
+            node = topologyToNode[ node ];
+        }
+
+        this->m_cpuToNode.resize( topology.MaxCpu() + 1, 0 );
+        for( std::size_t i = 0; i < topology.m_nodes.size(); ++i ) {
+            for( auto cpu: topology.m_nodes[ i ] ) {
+                this->m_cpuToNode[ cpu ] = topologyToNode[ i ];
+            }
+        }
+
+        for( std::size_t i = 0; i < nodes; ++i ) {
+            this->m_nodes.emplace_back( std::make_unique<Node>( this->m_opts.injection_queue_capacity ) );
+        }
+    } else {
+        this->m_nodes.emplace_back( std::make_unique<Node>( this->m_opts.injection_queue_capacity ) );
+    }
+
+    this->m_workers.reserve( count );
+    for( uint32_t i = 0; i < count; ++i ) {
+        auto& node = *this->m_nodes[ workerNodes[ i ] ];
+        ++node.m_workerCount;
+        this->m_workers.emplace_back( std::make_unique<Worker>( *this, node, i ) );
+        this->m_workers.back()->m_cpus = std::move( workerCpus[ i ] );
+        if( this->m_opts.latency_histograms ) {
+            this->m_workers.back()->m_scheduleLatency = std::make_unique<Private::HistogramRecorder>();
+            this->m_workers.back()->m_resumeDuration = std::make_unique<Private::HistogramRecorder>();
+        }
+    }
+
+    for( auto& worker: this->m_workers ) {
+        for( bool sameNode: { true, false } ) {
+            for( std::size_t i = 1; i < count; ++i ) {
+                auto* victim = this->m_workers[ ( worker->m_index + i ) % count ].get();
+                if( ( &victim->m_node == &worker->m_node ) == sameNode ) {
+                    worker->m_victims.emplace_back( victim );
+                }
+            }
+        }
+    }
+
+    this->m_threads.resize( count );
 
-    for( uint32_t i = 0; i < this->m_opts.thread_count; ++i ) {
-        this->m_threads.emplace_back( [ this, i ]( std::stop_token st ) { Executor( std::move( st ), i ); } );
+    const auto initial = this->m_opts.elastic ? this->m_opts.elastic->min_thread_count : count;
+    for( uint32_t i = 0; i < initial; ++i ) {
+        StartWorker( *this->m_workers[ i ] );
     }
 }
 
@@ -25,10 +171,64 @@ ThreadPool::~ThreadPool() {
     shutdown();
 }
 
-auto ThreadPool::Schedule() -> Operation {
+auto ThreadPool::Schedule( SchedulePriority priority ) -> Operation {
+    if( !this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
+        this->m_size.fetch_add( 1, std::memory_order::release );
+        return Operation { *this, priority };
+    }
+
+    throw std::runtime_error( "Coroutines::ThreadPool is shutting down, unable to Schedule new tasks." );
+}
+
+auto ThreadPool::ScheduleInline() -> Operation {
     if( !this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
         this->m_size.fetch_add( 1, std::memory_order::release );
-        return Operation { *this };
+        return Operation { *this, SchedulePriority::normal, false, true };
+    }
+
+    throw std::runtime_error( "Coroutines::ThreadPool is shutting down, unable to Schedule new tasks." );
+}
+
+auto ThreadPool::Reenter() noexcept -> Operation {
+    this->m_size.fetch_add( 1, std::memory_order::release );
+    return Operation { *this };
+}
+
+auto ThreadPool::BlockingPool() -> ThreadPool& {
+    std::scoped_lock lk { this->m_blockingPoolMutex };
+    if( this->m_blockingPool == nullptr ) {
+        if( this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
+            throw std::runtime_error( "Coroutines::ThreadPool is shutting down, unable to Schedule new tasks." );
+        }
+
+        // Defaults but for the size, scaling and idle behaviour.
+        options opts {};
+        opts.thread_count = this->m_opts.blocking_thread_count;
+        opts.idle = idle_policy::park_immediately();
+        opts.elastic = elastic_policy { .min_thread_count = 0, .spawn_backlog = 0, .idle_timeout = std::chrono::seconds { 10 } };
+        opts.blocking_thread_count = 0;
+        this->m_blockingPool = std::make_unique<ThreadPool>( std::move( opts ) );
+    }
+
+    return *this->m_blockingPool;
+}
+
+auto ThreadPool::ScheduleAfter( std::chrono::steady_clock::duration delay ) -> TimerOperation {
+    return ScheduleAt( std::chrono::steady_clock::now() + delay );
+}
+
+auto ThreadPool::ScheduleAt( std::chrono::steady_clock::time_point deadline ) -> TimerOperation {
+    if( !this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
+        return TimerOperation { *this, deadline };
+    }
+
+    throw std::runtime_error( "Coroutines::ThreadPool is shutting down, unable to Schedule new tasks." );
+}
+
+auto ThreadPool::yield() -> Operation {
+    if( !this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
+        this->m_size.fetch_add( 1, std::memory_order::release );
+        return Operation { *this, SchedulePriority::normal, true };
     }
 
     throw std::runtime_error( "Coroutines::ThreadPool is shutting down, unable to Schedule new tasks." );
@@ -43,10 +243,41 @@ auto ThreadPool::resume( std::coroutine_handle<> handle ) noexcept -> void {
     ScheduleImpl( handle );
 }
 
+auto ThreadPool::resume( std::coroutine_handle<> handle, SchedulePriority priority ) noexcept -> void {
+    if( handle == nullptr ) {
+        return;
+    }
+
+    this->m_size.fetch_add( 1, std::memory_order::release );
+    ScheduleImpl( handle, priority );
+}
+
 auto ThreadPool::shutdown() noexcept -> void {
     if( this->m_shutdownRequested.exchange( true, std::memory_order::acq_rel ) == false ) {
-        for( auto& thread: this->m_threads ) {
-            thread.request_stop();
+        // Blocking calls in flight come back to this pool's queues, let them finish while workers still run.
+        {
+            std::scoped_lock lk { this->m_blockingPoolMutex };
+            if( this->m_blockingPool != nullptr ) {
+                this->m_blockingPool->shutdown();
+            }
+        }
+
+        // Pending timers fire as cancelled so their coroutines get drained as well.
+        Private::TimerNode* pending = nullptr;
+        {
+            std::scoped_lock lk { this->m_timerMutex };
+            pending = this->m_timers.TakeAll();
+            this->m_nextDeadline.store( Private::TimerWheel::NO_DEADLINE, std::memory_order::seq_cst );
+        }
+        FireTimers( CurrentWorker(), pending, false );
+
+        {
+            // No worker gets started past this point.
+            std::scoped_lock lk { this->m_spawnMutex };
+            this->m_stopping = true;
+            for( auto& thread: this->m_threads ) {
+                thread.request_stop();
+            }
         }
 
         for( auto& thread: this->m_threads ) {
@@ -58,45 +289,628 @@ auto ThreadPool::shutdown() noexcept -> void {
 }
 
 auto ThreadPool::Executor( std::stop_token stop_token, std::size_t idx ) -> void {
+    auto& worker = *this->m_workers[ idx ];
+    auto& node = worker.m_node;
+    s_currentWorker = &worker;
+
+    if( !worker.m_cpus.empty() ) {
+        Private::PinCurrentThread( worker.m_cpus );
+    }
+
     if( this->m_opts.on_thread_start_functor != nullptr ) {
         this->m_opts.on_thread_start_functor( idx );
     }
 
-    while( !stop_token.stop_requested() ) {
-        while( true ) {
-            std::unique_lock<std::mutex> lk { this->m_waitMutex };
-            this->m_waitCv.wait( lk, stop_token, [ this ] { return !this->m_queue.empty(); } );
-            if( this->m_queue.empty() ) {
-                lk.unlock();
-                break;
-            }
+    auto& counters = worker.m_counters;
+    counters.m_starts.Add();
 
-            auto handle = this->m_queue.front();
-            this->m_queue.pop_front();
+    const auto budget = this->m_opts.cooperative_budget;
+    if( budget > 0 ) {
+        Private::CooperativeBudget::Install( this, &ThreadPool::RescheduleOverBudget );
+    }
 
-            lk.unlock();
+    // The clock is only read when the worker turns idle or busy, not per handle.
+    using clock = std::chrono::steady_clock;
+    std::optional<clock::time_point> runningSince;
+    auto stopRunning = [ & ] {
+        if( runningSince ) {
+            counters.m_runningNs.Add( std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now() - *runningSince ).count() );
+            runningSince.reset();
+        }
+    };
 
-            handle.resume();
+    bool woken = false;
+    while( true ) {
+        if( this->m_nextDeadline.load( std::memory_order::relaxed ) != Private::TimerWheel::NO_DEADLINE ) {
+            ExpireTimers( worker );
+        }
+
+        auto handle = NextHandle( worker );
+        if( handle == nullptr ) {
+            stopRunning();
+            handle = Spin( worker );
+        }
+
+        if( handle != nullptr ) {
+            if( !runningSince ) {
+                runningSince = clock::now();
+            }
+
+            // A single submission wakes one worker, pass the wake-up on while there is more to do.
+            if( std::exchange( woken, false ) && HasQueuedWork() ) {
+                NotifySleepingWorker( node );
+            }
+
+            COROUTINES_TRACE_RESUME_BEGIN( handle.address() );
+            Private::CooperativeBudget::Refill( budget );
+            if( worker.m_resumeDuration != nullptr ) {
+                const auto resumed = NowNs();
+                if( worker.m_stamp != 0 ) {
+                    worker.m_scheduleLatency->Record( resumed - worker.m_stamp );
+                }
+                handle.resume();
+                worker.m_resumeDuration->Record( NowNs() - resumed );
+            } else {
+                handle.resume();
+            }
+            COROUTINES_TRACE_RESUME_END( handle.address() );
             this->m_size.fetch_sub( 1, std::memory_order::release );
+            counters.m_tasks.Add();
+            continue;
+        }
+
+        counters.m_parks.Add();
+        const auto parkedSince = clock::now();
+
+        std::unique_lock<std::mutex> lk { node.m_waitMutex };
+        node.m_sleepingWorkers.fetch_add( 1, std::memory_order::seq_cst );
+
+        // One parked worker sleeps until the next timer deadline, the others until notified.
+        Node* noTimekeeper = nullptr;
+        bool timekeeper = this->m_nextDeadline.load( std::memory_order::seq_cst ) != Private::TimerWheel::NO_DEADLINE
+                          && this->m_timekeeper.compare_exchange_strong( noTimekeeper, &node, std::memory_order::seq_cst );
+        const auto deadline = this->m_nextDeadline.load( std::memory_order::seq_cst );
+        if( timekeeper && deadline == Private::TimerWheel::NO_DEADLINE ) {
+            this->m_timekeeper.store( nullptr, std::memory_order::seq_cst );
+            timekeeper = false;
+        }
+
+        bool hasWork = false;
+        if( timekeeper ) {
+            hasWork = node.m_waitCv.wait_until( lk, stop_token, Private::TimerWheel::ToTimePoint( deadline ), [ this, deadline ] {
+                return HasQueuedWork() || this->m_nextDeadline.load( std::memory_order::seq_cst ) < deadline;
+            } );
+            this->m_timekeeper.store( nullptr, std::memory_order::seq_cst );
+        } else if( this->m_opts.elastic ) {
+            hasWork = node.m_waitCv.wait_for( lk, stop_token, this->m_opts.elastic->idle_timeout, [ this ] { return HasQueuedWork() || NeedsTimekeeper(); } );
+        } else {
+            hasWork = node.m_waitCv.wait( lk, stop_token, [ this ] { return HasQueuedWork() || NeedsTimekeeper(); } );
+        }
+        node.m_sleepingWorkers.fetch_sub( 1, std::memory_order::relaxed );
+        lk.unlock();
+        woken = hasWork;
+
+        counters.m_parkedNs.Add( std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now() - parkedSince ).count() );
+        if( hasWork ) {
+            counters.m_wakeups.Add();
+        }
+
+        // Keep draining after a stop request until nothing is left to run.
+        if( !hasWork && stop_token.stop_requested() ) {
+            break;
+        }
+
+        if( !hasWork && !timekeeper && this->m_opts.elastic && TryRetire() ) {
+            break;
         }
     }
 
+    stopRunning();
+    Private::CooperativeBudget::Install( nullptr, nullptr );
+
     if( this->m_opts.on_thread_stop_functor != nullptr ) {
         this->m_opts.on_thread_stop_functor( idx );
     }
+
+    s_currentWorker = nullptr;
+    worker.m_active.store( false, std::memory_order::release );
 }
 
-auto ThreadPool::ScheduleImpl( std::coroutine_handle<> handle ) noexcept -> void {
-    if( handle == nullptr ) {
+auto ThreadPool::StartWorker( Worker& worker ) -> void {
+    const auto idx = worker.m_index;
+    auto& thread = this->m_threads[ idx ];
+
+    // A retired worker's thread is done or about to be, reap it before reusing the slot.
+    if( thread.joinable() ) {
+        thread.join();
+    }
+
+    worker.m_active.store( true, std::memory_order::relaxed );
+    this->m_runningWorkers.fetch_add( 1, std::memory_order::seq_cst );
+    try {
+        thread = std::jthread { [ this, idx ]( std::stop_token st ) { Executor( std::move( st ), idx ); } };
+    } catch( ... ) {
+        this->m_runningWorkers.fetch_sub( 1, std::memory_order::seq_cst );
+        worker.m_active.store( false, std::memory_order::relaxed );
+        throw;
+    }
+}
+
+auto ThreadPool::SpawnWorker( Node& preferred ) noexcept -> void {
+    const auto running = this->m_runningWorkers.load( std::memory_order::seq_cst );
+    if( running >= this->m_opts.thread_count ) {
+        return;
+    }
+
+    // m_size includes the handles being run right now.
+    const auto size = this->m_size.load( std::memory_order::relaxed );
+    const auto backlog = size > running ? size - running : 0;
+    if( running > 0 && backlog <= running * this->m_opts.elastic->spawn_backlog ) {
+        return;
+    }
+
+    std::scoped_lock lk { this->m_spawnMutex };
+    if( this->m_stopping || this->m_runningWorkers.load( std::memory_order::relaxed ) >= this->m_opts.thread_count ) {
+        return;
+    }
+
+    Worker* candidate = nullptr;
+    for( const auto& worker: this->m_workers ) {
+        if( !worker->m_active.load( std::memory_order::acquire ) ) {
+            candidate = worker.get();
+            if( &worker->m_node == &preferred ) {
+                break;
+            }
+        }
+    }
+
+    if( candidate == nullptr ) {
         return;
     }
 
+    try {
+        StartWorker( *candidate );
+    } catch( ... ) {
+        // Out of threads, the running workers will get to the backlog eventually.
+    }
+}
+
+auto ThreadPool::TryRetire() noexcept -> bool {
+    const auto min = this->m_opts.elastic->min_thread_count;
+    auto running = this->m_runningWorkers.load( std::memory_order::relaxed );
+    do {
+        if( running <= min ) {
+            return false;
+        }
+    } while( !this->m_runningWorkers.compare_exchange_weak( running, running - 1, std::memory_order::seq_cst ) );
+
+    // A submitter that still counted this worker as running may not have started
+    // another one, stay if something got queued in the meantime.
+    if( HasQueuedWork() || NeedsTimekeeper() ) {
+        this->m_runningWorkers.fetch_add( 1, std::memory_order::seq_cst );
+        return false;
+    }
+
+    return true;
+}
+
+auto ThreadPool::AddTimer( Private::TimerNode& node ) noexcept -> bool {
+    std::unique_lock lk { this->m_timerMutex };
+    if( this->m_shutdownRequested.load( std::memory_order::relaxed ) ) {
+        return false;
+    }
+
+    this->m_timers.Insert( node );
+    const auto next = this->m_timers.NextDeadline();
+    if( next >= this->m_nextDeadline.load( std::memory_order::relaxed ) ) {
+        return true;
+    }
+    this->m_nextDeadline.store( next, std::memory_order::seq_cst );
+    lk.unlock();
+
+    // The deadline moved up, the timekeeper has to park again with the new one.
+    if( auto* keeper = this->m_timekeeper.load( std::memory_order::seq_cst ); keeper != nullptr ) {
+        { std::scoped_lock waitLock { keeper->m_waitMutex }; }
+        keeper->m_waitCv.notify_all();
+    } else {
+        NotifySleepingWorker( SubmitterNode( CurrentWorker() ) );
+    }
+
+    return true;
+}
+
+auto ThreadPool::CancelTimer( Private::TimerNode& node ) noexcept -> bool {
     {
-        std::scoped_lock lk { this->m_waitMutex };
-        this->m_queue.emplace_back( handle );
+        std::scoped_lock lk { this->m_timerMutex };
+        if( !this->m_timers.Remove( node ) ) {
+            return false;
+        }
+        this->m_nextDeadline.store( this->m_timers.NextDeadline(), std::memory_order::seq_cst );
+    }
+
+    FireTimers( CurrentWorker(), &node, false );
+    return true;
+}
+
+auto ThreadPool::ExpireTimers( Worker& worker ) noexcept -> void {
+    const auto now = Private::TimerWheel::NowTick();
+    if( now < this->m_nextDeadline.load( std::memory_order::acquire ) ) {
+        return;
+    }
+
+    // Another worker already expires them.
+    std::unique_lock lk { this->m_timerMutex, std::try_to_lock };
+    if( !lk.owns_lock() ) {
+        return;
+    }
+
+    auto* fired = this->m_timers.Advance( now );
+    this->m_nextDeadline.store( this->m_timers.NextDeadline(), std::memory_order::seq_cst );
+    lk.unlock();
+
+    FireTimers( &worker, fired, true );
+}
+
+auto ThreadPool::FireTimers( Worker* worker, Private::TimerNode* fired, bool expired ) noexcept -> void {
+    auto& node = SubmitterNode( worker );
+    std::size_t count = 0;
+    while( fired != nullptr ) {
+        auto* next = fired->m_next;
+        if( auto handle = fired->m_fire( *fired, expired ); handle != nullptr ) {
+            this->m_size.fetch_add( 1, std::memory_order::release );
+            Enqueue( worker, node, handle, SchedulePriority::normal, false );
+            ++count;
+        }
+        fired = next;
+    }
+
+    if( count > 0 ) {
+        NotifySleepingWorker( node, count );
+    }
+}
+
+auto ThreadPool::NeedsTimekeeper() const noexcept -> bool {
+    return this->m_nextDeadline.load( std::memory_order::seq_cst ) != Private::TimerWheel::NO_DEADLINE
+           && this->m_timekeeper.load( std::memory_order::seq_cst ) == nullptr;
+}
+
+auto ThreadPool::NextHandle( Worker& worker ) noexcept -> std::coroutine_handle<> {
+    const auto limit = this->m_opts.priority_aging_limit;
+    auto& passedOver = worker.m_passedOver;
+
+    // Aging, a level passed over for too long goes first once.
+    for( auto priority: { SchedulePriority::low, SchedulePriority::normal } ) {
+        auto& count = passedOver[ static_cast<std::size_t>( priority ) ];
+        if( count >= limit ) {
+            count = 0;
+            if( auto handle = NextHandle( worker, priority ); handle != nullptr ) {
+                return handle;
+            }
+        }
+    }
+
+    for( auto priority: { SchedulePriority::high, SchedulePriority::normal, SchedulePriority::low } ) {
+        if( auto handle = NextHandle( worker, priority ); handle != nullptr ) {
+            for( auto lower = static_cast<std::size_t>( priority ) + 1; lower < PRIORITY_COUNT; ++lower ) {
+                ++passedOver[ lower ];
+            }
+            passedOver[ static_cast<std::size_t>( priority ) ] = 0;
+            return handle;
+        }
+    }
+
+    return nullptr;
+}
+
+auto ThreadPool::NextHandle( Worker& worker, SchedulePriority priority ) noexcept -> std::coroutine_handle<> {
+    if( priority == SchedulePriority::normal ) {
+        return NextNormalHandle( worker );
+    }
+
+    const auto level = static_cast<std::size_t>( priority );
+    if( auto handle = PopInjected( worker, worker.m_node.m_injectionQueues[ level ] ); handle != nullptr ) {
+        return handle;
+    }
+
+    for( auto& node: this->m_nodes ) {
+        if( node.get() != &worker.m_node ) {
+            if( auto handle = PopInjected( worker, node->m_injectionQueues[ level ] ); handle != nullptr ) {
+                return handle;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+auto ThreadPool::NextNormalHandle( Worker& worker ) noexcept -> std::coroutine_handle<> {
+    constexpr auto NORMAL = static_cast<std::size_t>( SchedulePriority::normal );
+
+    if( this->m_opts.run_next_slot ) {
+        if( worker.m_runNextStreak < this->m_opts.run_next_limit ) {
+            if( auto handle = TakeRunNext( worker, worker ); handle != nullptr ) {
+                ++worker.m_runNextStreak;
+                return handle;
+            }
+        }
+
+        worker.m_runNextStreak = 0;
+    }
+
+    if( auto handle = worker.m_localQueue.Pop( worker.m_stamp ); handle != nullptr ) {
+        return handle;
+    }
+
+    if( auto handle = PopInjected( worker, worker.m_node.m_injectionQueues[ NORMAL ] ); handle != nullptr ) {
+        return handle;
+    }
+
+    for( auto& node: this->m_nodes ) {
+        if( node.get() != &worker.m_node ) {
+            if( auto handle = PopInjected( worker, node->m_injectionQueues[ NORMAL ] ); handle != nullptr ) {
+                return handle;
+            }
+        }
+    }
+
+    // Nothing else queued, the fairness limit does not apply.
+    if( auto handle = TakeRunNext( worker, worker ); handle != nullptr ) {
+        return handle;
+    }
+
+    if( this->m_opts.work_stealing ) {
+        for( auto* victim: worker.m_victims ) {
+            if( auto handle = victim->m_localQueue.Steal( worker.m_stamp ); handle != nullptr ) {
+                worker.m_counters.m_steals.Add();
+                return handle;
+            }
+        }
+    }
+
+    // Last resort, the owner may be stuck in a long running handle.
+    for( auto* victim: worker.m_victims ) {
+        if( auto handle = TakeRunNext( *victim, worker ); handle != nullptr ) {
+            worker.m_counters.m_steals.Add();
+            return handle;
+        }
+    }
+
+    return nullptr;
+}
+
+auto ThreadPool::PopInjected( Worker& worker, Private::InjectionQueue& queue ) noexcept -> std::coroutine_handle<> {
+    auto handle = queue.Pop( worker.m_stamp );
+    if( handle != nullptr ) {
+        worker.m_counters.m_injectionHighWater.Max( queue.size() + 1 );
+    }
+    return handle;
+}
+
+auto ThreadPool::Spin( Worker& worker ) noexcept -> std::coroutine_handle<> {
+    const auto spins = this->m_opts.idle.spin_iterations;
+    const auto polls = spins + this->m_opts.idle.yield_iterations;
+    if( polls == 0 ) {
+        return nullptr;
+    }
+
+    // Spinning more than half of the node's workers just burns cores.
+    auto& node = worker.m_node;
+    const std::size_t maxSpinning = std::max<std::size_t>( 1, node.m_workerCount / 2 );
+    if( node.m_spinningWorkers.fetch_add( 1, std::memory_order::seq_cst ) >= maxSpinning ) {
+        node.m_spinningWorkers.fetch_sub( 1, std::memory_order::seq_cst );
+        return nullptr;
+    }
+    worker.m_counters.m_spins.Add();
+
+    std::coroutine_handle<> handle = nullptr;
+    for( uint32_t i = 0; i < polls && handle == nullptr; ++i ) {
+        if( i < spins ) {
+            CpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+        handle = NextHandle( worker );
+    }
+
+    // Submitters did not notify anyone while this worker was spinning, hand
+    // the remaining work over to a sleeper if this was the last spinner.
+    if( node.m_spinningWorkers.fetch_sub( 1, std::memory_order::seq_cst ) == 1 && handle != nullptr && HasQueuedWork() ) {
+        NotifySleepingWorker( node );
+    }
+
+    return handle;
+}
+
+auto ThreadPool::TryResumeInline() noexcept -> bool {
+    if( CurrentWorker() == nullptr ) {
+        return false;
+    }
+
+    // Nothing gets queued, undo the count taken by ScheduleInline().
+    this->m_size.fetch_sub( 1, std::memory_order::release );
+    return true;
+}
+
+auto ThreadPool::RescheduleOverBudget( void* threadPool, std::coroutine_handle<> handle ) noexcept -> void {
+    // The injection queue instead of the worker's deque, which would hand it straight back.
+    auto& tp = *static_cast<ThreadPool*>( threadPool );
+    auto& node = tp.SubmitterNode( tp.CurrentWorker() );
+    tp.m_size.fetch_add( 1, std::memory_order::release );
+    tp.Enqueue( nullptr, node, handle, SchedulePriority::normal, false );
+    tp.NotifySleepingWorker( node );
+}
+
+auto ThreadPool::TakeRunNext( Worker& worker, Worker& thief ) noexcept -> std::coroutine_handle<> {
+    if( worker.m_runNext.load( std::memory_order::relaxed ) == nullptr ) {
+        return nullptr;
+    }
+
+    auto handle = std::coroutine_handle<>::from_address( worker.m_runNext.exchange( nullptr, std::memory_order::acq_rel ) );
+    thief.m_stamp = worker.m_runNextStamp.load( std::memory_order::relaxed );
+    return handle;
+}
+
+auto ThreadPool::HasQueuedWork() const noexcept -> bool {
+    // Pairs with the fence in NotifySleepingWorker(): either the pusher sees this
+    // worker in m_sleepingWorkers or this worker sees the pushed handle.
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+    for( const auto& node: this->m_nodes ) {
+        for( const auto& queue: node->m_injectionQueues ) {
+            if( !queue.empty() ) {
+                return true;
+            }
+        }
+    }
+
+    for( const auto& worker: this->m_workers ) {
+        if( !worker->m_localQueue.empty() || worker->m_runNext.load( std::memory_order::relaxed ) != nullptr ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto ThreadPool::SubmitterNode( Worker* worker ) const noexcept -> Node& {
+    if( worker != nullptr ) {
+        return worker->m_node;
+    }
+
+    if( this->m_nodes.size() == 1 ) {
+        return *this->m_nodes.front();
+    }
+
+    const auto cpu = Private::CurrentCpu();
+    if( cpu < 0 || static_cast<std::size_t>( cpu ) >= this->m_cpuToNode.size() ) {
+        return *this->m_nodes.front();
+    }
+
+    return *this->m_nodes[ this->m_cpuToNode[ cpu ] ];
+}
+
+auto ThreadPool::Enqueue( Worker* worker, Node& node, std::coroutine_handle<> handle, SchedulePriority priority, bool runNext ) noexcept -> void {
+    auto stamp = this->m_opts.latency_histograms ? NowNs() : 0;
+    if( priority != SchedulePriority::normal ) {
+        node.m_injectionQueues[ static_cast<std::size_t>( priority ) ].Push( handle, stamp );
+        return;
+    }
+
+    if( worker != nullptr && runNext && this->m_opts.run_next_slot ) {
+        // The displaced handle is queued with its own stamp.
+        if( this->m_opts.latency_histograms ) {
+            stamp = worker->m_runNextStamp.exchange( stamp, std::memory_order::relaxed );
+        }
+        handle = std::coroutine_handle<>::from_address( worker->m_runNext.exchange( handle.address(), std::memory_order::acq_rel ) );
+        if( handle == nullptr ) {
+            return;
+        }
+    }
+
+    if( worker != nullptr && this->m_opts.work_stealing && worker->m_localQueue.Push( handle, stamp ) ) {
+        worker->m_counters.m_localHighWater.Max( worker->m_localQueue.size() );
+        return;
+    }
+
+    node.m_injectionQueues[ static_cast<std::size_t>( SchedulePriority::normal ) ].Push( handle, stamp );
+}
+
+auto ThreadPool::Metrics() const -> metrics {
+    metrics result;
+    result.size = size();
+    result.queue_size = queue_size();
+
+    for( const auto& node: this->m_nodes ) {
+        for( const auto& queue: node->m_injectionQueues ) {
+            result.injection_push_contention += queue.PushContention();
+            result.injection_overflow_pushes += queue.OverflowPushes();
+        }
+    }
+
+    result.workers.reserve( this->m_workers.size() );
+    for( const auto& worker: this->m_workers ) {
+        const auto& counters = worker->m_counters;
+        result.workers.emplace_back( worker_metrics { .index = worker->m_index,
+                                                      .running = worker->m_active.load( std::memory_order::relaxed ),
+                                                      .starts = counters.m_starts.Load(),
+                                                      .tasks_executed = counters.m_tasks.Load(),
+                                                      .steals = counters.m_steals.Load(),
+                                                      .spins = counters.m_spins.Load(),
+                                                      .parks = counters.m_parks.Load(),
+                                                      .wakeups = counters.m_wakeups.Load(),
+                                                      .parked_time = std::chrono::nanoseconds { counters.m_parkedNs.Load() },
+                                                      .running_time = std::chrono::nanoseconds { counters.m_runningNs.Load() },
+                                                      .local_queue_high_water = counters.m_localHighWater.Load(),
+                                                      .injection_queue_high_water = counters.m_injectionHighWater.Load(),
+                                                      .schedule_latency = Histogram {},
+                                                      .resume_duration = Histogram {} } );
+
+        if( worker->m_scheduleLatency != nullptr ) {
+            auto& snapshot = result.workers.back();
+            worker->m_scheduleLatency->MergeInto( snapshot.schedule_latency );
+            worker->m_resumeDuration->MergeInto( snapshot.resume_duration );
+            result.schedule_latency.Merge( snapshot.schedule_latency );
+            result.resume_duration.Merge( snapshot.resume_duration );
+        }
+    }
+
+    return result;
+}
+
+auto ThreadPool::NotifySleepingWorker( Node& preferred, std::size_t count ) noexcept -> void {
+    std::atomic_thread_fence( std::memory_order::seq_cst );
+
+    // A spinning worker polls every node's queues and will pick a handle up.
+    for( const auto& node: this->m_nodes ) {
+        count -= std::min( count, node->m_spinningWorkers.load( std::memory_order::relaxed ) );
+    }
+
+    auto wake = [ &count ]( Node& node ) -> void {
+        const auto sleeping = node.m_sleepingWorkers.load( std::memory_order::relaxed );
+        if( sleeping == 0 ) {
+            return;
+        }
+
+        // Taking the mutex orders this notification after the sleepers' predicate check.
+        { std::scoped_lock lk { node.m_waitMutex }; }
+        if( count >= sleeping ) {
+            node.m_waitCv.notify_all();
+            count -= sleeping;
+            return;
+        }
+
+        for( ; count > 0; --count ) {
+            node.m_waitCv.notify_one();
+        }
+    };
+
+    if( count > 0 ) {
+        wake( preferred );
+    }
+
+    for( const auto& node: this->m_nodes ) {
+        if( count == 0 ) {
+            return;
+        }
+        if( node.get() != &preferred ) {
+            wake( *node );
+        }
+    }
+
+    // Nobody idle to take the rest.
+    if( count > 0 && this->m_opts.elastic ) {
+        SpawnWorker( preferred );
+    }
+}
+
+auto ThreadPool::ScheduleImpl( std::coroutine_handle<> handle, SchedulePriority priority, bool yield ) noexcept -> void {
+    if( handle == nullptr ) {
+        return;
     }
 
-    this->m_waitCv.notify_one();
+    auto* worker = CurrentWorker();
+    auto& node = SubmitterNode( worker );
+    Enqueue( worker, node, handle, priority, !yield );
+    NotifySleepingWorker( node );
 }
 
 }
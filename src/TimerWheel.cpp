@@ -0,0 +1,184 @@
+#include "Coroutines/Private/TimerWheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace Coroutines::Private {
+
+auto TimerWheel::DeadlineTick( std::chrono::steady_clock::time_point deadline ) noexcept -> std::int64_t {
+    return std::chrono::ceil<std::chrono::milliseconds>( deadline.time_since_epoch() ).count();
+}
+
+auto TimerWheel::NowTick() noexcept -> std::int64_t {
+    return std::chrono::floor<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+auto TimerWheel::ToTimePoint( std::int64_t tick ) noexcept -> std::chrono::steady_clock::time_point {
+    return std::chrono::steady_clock::time_point { std::chrono::milliseconds { tick } };
+}
+
+TimerWheel::TimerWheel() noexcept
+    : m_current( NowTick() ) {
+}
+
+auto TimerWheel::Insert( TimerNode& node ) noexcept -> void {
+    Link( node );
+    ++this->m_size;
+}
+
+auto TimerWheel::Remove( TimerNode& node ) noexcept -> bool {
+    if( !node.m_linked ) {
+        return false;
+    }
+
+    Unlink( node );
+    --this->m_size;
+    return true;
+}
+
+auto TimerWheel::Advance( std::int64_t now ) noexcept -> TimerNode* {
+    TimerNode* fired = nullptr;
+    while( this->m_size > 0 ) {
+        std::size_t level = 0;
+        std::size_t slot = 0;
+        const auto tick = NextExpiration( level, slot );
+        if( tick > now ) {
+            break;
+        }
+
+        this->m_current = tick;
+        if( slot == SLOTS ) {
+            continue;
+        }
+
+        auto* node = std::exchange( this->m_slots[ level ][ slot ], nullptr );
+        this->m_occupied[ level ] &= ~( std::uint64_t { 1 } << slot );
+        while( node != nullptr ) {
+            auto* next = node->m_next;
+            if( node->m_tick <= this->m_current ) {
+                node->m_linked = false;
+                node->m_prev = nullptr;
+                node->m_next = fired;
+                fired = node;
+                --this->m_size;
+            } else {
+                // Cascade into a lower level.
+                Link( *node );
+            }
+            node = next;
+        }
+    }
+
+    this->m_current = std::max( this->m_current, now );
+    return fired;
+}
+
+auto TimerWheel::TakeAll() noexcept -> TimerNode* {
+    TimerNode* all = nullptr;
+    for( std::size_t level = 0; level < LEVELS; ++level ) {
+        for( auto& head: this->m_slots[ level ] ) {
+            auto* node = std::exchange( head, nullptr );
+            while( node != nullptr ) {
+                auto* next = node->m_next;
+                node->m_linked = false;
+                node->m_prev = nullptr;
+                node->m_next = all;
+                all = node;
+                node = next;
+            }
+        }
+        this->m_occupied[ level ] = 0;
+    }
+
+    this->m_size = 0;
+    return all;
+}
+
+auto TimerWheel::NextDeadline() const noexcept -> std::int64_t {
+    if( this->m_size == 0 ) {
+        return NO_DEADLINE;
+    }
+
+    std::size_t level = 0;
+    std::size_t slot = 0;
+    return NextExpiration( level, slot );
+}
+
+auto TimerWheel::NextExpiration( std::size_t& level, std::size_t& slot ) const noexcept -> std::int64_t {
+    // Every node shares the bits above its level with m_current and sits at or after
+    // m_current's slot on that level, so the lowest occupied level holds the next expiration.
+    for( level = 0; level < LEVELS; ++level ) {
+        const auto occupied = this->m_occupied[ level ];
+        if( occupied == 0 ) {
+            continue;
+        }
+
+        const auto shift = level * SLOT_BITS;
+        const auto upper = shift + SLOT_BITS;
+        const auto index = static_cast<std::size_t>( this->m_current >> shift ) & ( SLOTS - 1 );
+        const auto ahead = occupied & ( ~std::uint64_t { 0 } << index );
+        if( ahead == 0 ) {
+            // Only for deadlines clamped past the wheel's range.
+            slot = SLOTS;
+            return ( ( this->m_current >> upper ) + 1 ) << upper;
+        }
+
+        slot = static_cast<std::size_t>( std::countr_zero( ahead ) );
+        return ( ( this->m_current >> upper ) << upper ) | static_cast<std::int64_t>( slot << shift );
+    }
+
+    slot = SLOTS;
+    return NO_DEADLINE;
+}
+
+auto TimerWheel::Link( TimerNode& node ) noexcept -> void {
+    auto tick = std::max( node.m_tick, this->m_current );
+    if( ( tick ^ this->m_current ) >= RANGE ) {
+        // Out of range, park it at the far end and re-insert from there.
+        tick = this->m_current | ( RANGE - 1 );
+        if( tick == this->m_current ) {
+            ++tick;
+        }
+    }
+
+    std::size_t level = 0;
+    if( tick != this->m_current ) {
+        const auto width = static_cast<std::size_t>( std::bit_width( static_cast<std::uint64_t>( tick ^ this->m_current ) ) );
+        level = std::min( LEVELS - 1, ( width - 1 ) / SLOT_BITS );
+    }
+
+    const auto slot = static_cast<std::size_t>( tick >> ( level * SLOT_BITS ) ) & ( SLOTS - 1 );
+    auto& head = this->m_slots[ level ][ slot ];
+    node.m_level = static_cast<std::uint8_t>( level );
+    node.m_slot = static_cast<std::uint8_t>( slot );
+    node.m_prev = nullptr;
+    node.m_next = head;
+    if( head != nullptr ) {
+        head->m_prev = &node;
+    }
+    head = &node;
+    this->m_occupied[ level ] |= std::uint64_t { 1 } << slot;
+    node.m_linked = true;
+}
+
+auto TimerWheel::Unlink( TimerNode& node ) noexcept -> void {
+    auto& head = this->m_slots[ node.m_level ][ node.m_slot ];
+    if( node.m_prev != nullptr ) {
+        node.m_prev->m_next = node.m_next;
+    } else {
+        head = node.m_next;
+    }
+    if( node.m_next != nullptr ) {
+        node.m_next->m_prev = node.m_prev;
+    }
+    if( head == nullptr ) {
+        this->m_occupied[ node.m_level ] &= ~( std::uint64_t { 1 } << node.m_slot );
+    }
+
+    node.m_prev = nullptr;
+    node.m_next = nullptr;
+    node.m_linked = false;
+}
+
+}
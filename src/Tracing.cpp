@@ -0,0 +1,168 @@
+#include "Coroutines/Tracing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Coroutines {
+namespace {
+    struct Registry {
+        std::mutex m_mutex;
+        // Buffers outlive their threads so events can be written after the thread exited.
+        std::vector<std::shared_ptr<Private::TraceBuffer>> m_buffers;
+    };
+
+    auto GetRegistry() -> Registry& {
+        static Registry registry;
+        return registry;
+    }
+
+    auto WriteEscaped( std::ostream& out, std::string_view text ) -> void {
+        for( auto c: text ) {
+            if( c == '"' || c == '\\' ) {
+                out << '\\' << c;
+            } else if( static_cast<unsigned char>( c ) >= 0x20 ) {
+                out << c;
+            }
+        }
+    }
+}
+
+auto Private::TraceLog::Now() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+auto Private::TraceLog::LocalBuffer() noexcept -> TraceBuffer* {
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if( buffer == nullptr ) [[unlikely]] {
+        try {
+            auto& registry = GetRegistry();
+            std::scoped_lock lk { registry.m_mutex };
+            buffer = std::make_shared<TraceBuffer>( static_cast<std::uint32_t>( registry.m_buffers.size() + 1 ) );
+            registry.m_buffers.emplace_back( buffer );
+        } catch( ... ) {
+            buffer = nullptr;
+        }
+    }
+
+    return buffer.get();
+}
+
+auto Tracing::Start() noexcept -> void {
+#ifdef COROUTINES_TRACING
+    Private::TraceLog::s_enabled.store( true, std::memory_order::relaxed );
+#endif
+}
+
+auto Tracing::Stop() noexcept -> void {
+    Private::TraceLog::s_enabled.store( false, std::memory_order::relaxed );
+}
+
+auto Tracing::IsAvailable() noexcept -> bool {
+#ifdef COROUTINES_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Tracing::Clear() -> void {
+    auto& registry = GetRegistry();
+    std::scoped_lock lk { registry.m_mutex };
+    for( auto& buffer: registry.m_buffers ) {
+        buffer->m_cleared = buffer->m_written.load( std::memory_order::acquire );
+    }
+}
+
+auto Tracing::WriteChromeJson( const std::filesystem::path& path ) -> void {
+    std::ofstream out { path };
+    if( !out ) {
+        throw std::runtime_error( "Coroutines::Tracing unable to open " + path.string() + "." );
+    }
+
+    std::vector<std::shared_ptr<Private::TraceBuffer>> buffers;
+    {
+        auto& registry = GetRegistry();
+        std::scoped_lock lk { registry.m_mutex };
+        buffers = registry.m_buffers;
+    }
+
+    auto range = []( const Private::TraceBuffer& buffer ) {
+        const auto written = buffer.m_written.load( std::memory_order::acquire );
+        const auto first = std::max( { buffer.m_cleared, written > Private::TraceBuffer::CAPACITY ? written - Private::TraceBuffer::CAPACITY : 0 } );
+        return std::pair { first, written };
+    };
+
+    // Frames get reused, a resumed coroutine is named after the latest creation at its address.
+    std::vector<std::tuple<const void*, std::int64_t, std::source_location>> creations;
+    std::int64_t origin = std::numeric_limits<std::int64_t>::max();
+    for( const auto& buffer: buffers ) {
+        const auto [ first, written ] = range( *buffer );
+        for( auto i = first; i < written; ++i ) {
+            const auto& event = buffer->m_events[ i & ( Private::TraceBuffer::CAPACITY - 1 ) ];
+            origin = std::min( origin, event.m_time );
+            if( event.m_kind == Private::TraceEventKind::create ) {
+                creations.emplace_back( event.m_coroutine, event.m_time, event.m_location );
+            }
+        }
+    }
+    std::ranges::sort( creations, []( const auto& a, const auto& b ) { return std::tie( std::get<0>( a ), std::get<1>( a ) ) < std::tie( std::get<0>( b ), std::get<1>( b ) ); } );
+
+    auto functionOf = [ &creations ]( const void* coroutine, std::int64_t time ) -> std::string_view {
+        auto it = std::ranges::upper_bound( creations, std::pair { coroutine, time }, std::less {}, []( const auto& creation ) { return std::pair { std::get<0>( creation ), std::get<1>( creation ) }; } );
+        if( it == creations.begin() || std::get<0>( *std::prev( it ) ) != coroutine ) {
+            return "coroutine";
+        }
+        return std::get<2>( *std::prev( it ) ).function_name();
+    };
+
+    // Timestamps are in microseconds since the first event.
+    out << std::fixed << std::setprecision( 3 ) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool separator = false;
+    for( const auto& buffer: buffers ) {
+        const auto [ first, written ] = range( *buffer );
+        for( auto i = first; i < written; ++i ) {
+            const auto& event = buffer->m_events[ i & ( Private::TraceBuffer::CAPACITY - 1 ) ];
+            out << ( std::exchange( separator, true ) ? ",\n" : "\n" ) << "{\"pid\":1,\"tid\":" << buffer->m_thread << ",\"ts\":" << static_cast<double>( event.m_time - origin ) / 1000.0;
+
+            switch( event.m_kind ) {
+                case Private::TraceEventKind::create:
+                    out << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"create ";
+                    WriteEscaped( out, event.m_location.function_name() );
+                    out << "\",\"args\":{\"coroutine\":\"" << event.m_coroutine << "\",\"file\":\"";
+                    WriteEscaped( out, event.m_location.file_name() );
+                    out << "\",\"line\":" << event.m_location.line() << "}}";
+                    break;
+                case Private::TraceEventKind::resume_begin:
+                case Private::TraceEventKind::resume_end:
+                    out << ",\"ph\":\"" << ( event.m_kind == Private::TraceEventKind::resume_begin ? 'B' : 'E' ) << "\",\"name\":\"";
+                    WriteEscaped( out, functionOf( event.m_coroutine, event.m_time ) );
+                    out << "\",\"args\":{\"coroutine\":\"" << event.m_coroutine << "\"}}";
+                    break;
+                case Private::TraceEventKind::suspend:
+                    out << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"";
+                    WriteEscaped( out, event.m_name );
+                    out << "\",\"args\":{\"coroutine\":\"" << event.m_coroutine << "\",\"in\":\"";
+                    WriteEscaped( out, functionOf( event.m_coroutine, event.m_time ) );
+                    out << "\"}}";
+                    break;
+            }
+        }
+    }
+    out << "\n]}\n";
+
+    if( !out ) {
+        throw std::runtime_error( "Coroutines::Tracing unable to write " + path.string() + "." );
+    }
+}
+
+}
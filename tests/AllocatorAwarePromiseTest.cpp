@@ -0,0 +1,174 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+namespace {
+
+// What a Counting allocator handed out and got back, possibly on different threads.
+struct Ledger {
+    std::atomic<int> m_allocations { 0 };
+    std::atomic<int> m_deallocations { 0 };
+    // Sum of the sizes, the deallocations must give back what the allocations took.
+    std::atomic<std::size_t> m_allocated { 0 };
+    std::atomic<std::size_t> m_deallocated { 0 };
+
+    auto Balanced( int count ) const -> bool {
+        return this->m_allocations.load() == count && this->m_deallocations.load() == count && this->m_allocated.load() == this->m_deallocated.load();
+    }
+};
+
+// Stateful allocator, the frame keeps a copy that frees it.
+template<typename T>
+struct Counting {
+    using value_type = T;
+
+    explicit Counting( Ledger& ledger ) noexcept
+        : m_ledger( &ledger ) {
+    }
+    template<typename U>
+    Counting( const Counting<U>& other ) noexcept
+        : m_ledger( other.m_ledger ) {
+    }
+
+    auto allocate( std::size_t n ) -> T* {
+        this->m_ledger->m_allocations.fetch_add( 1 );
+        this->m_ledger->m_allocated.fetch_add( n * sizeof( T ) );
+        return std::allocator<T> {}.allocate( n );
+    }
+    auto deallocate( T* p, std::size_t n ) noexcept -> void {
+        this->m_ledger->m_deallocations.fetch_add( 1 );
+        this->m_ledger->m_deallocated.fetch_add( n * sizeof( T ) );
+        std::allocator<T> {}.deallocate( p, n );
+    }
+
+    template<typename U>
+    auto operator==( const Counting<U>& other ) const noexcept -> bool {
+        return this->m_ledger == other.m_ledger;
+    }
+
+    Ledger* m_ledger;
+};
+
+auto Leaf( std::allocator_arg_t, Counting<char>, int value ) -> Task<int> {
+    co_return value;
+}
+
+auto Plain( int value ) -> Task<int> {
+    co_return value;
+}
+
+auto Count( std::allocator_arg_t, const Counting<int>&, int n ) -> Generator<int> {
+    for( int i = 0; i < n; ++i ) {
+        co_yield i;
+    }
+}
+
+struct Object {
+    auto Add( std::allocator_arg_t, Counting<long>, int value ) -> Task<int> {
+        co_return this->m_base + value;
+    }
+
+    int m_base = 100;
+};
+
+// Free functions, member functions and lambdas allocate once from the allocator and free
+// through the copy kept behind the frame, other frames do not touch it.
+auto Paired() -> void {
+    Ledger ledger;
+    CHECK( SyncWait( Leaf( std::allocator_arg, Counting<char>( ledger ), 5 ) ) == 5 );
+    CHECK( ledger.Balanced( 1 ) );
+
+    CHECK( SyncWait( Plain( 4 ) ) == 4 );
+    CHECK( ledger.Balanced( 1 ) );
+
+    int sum = 0;
+    for( int value: Count( std::allocator_arg, Counting<int>( ledger ), 10 ) ) {
+        sum += value;
+    }
+    CHECK( sum == 45 && ledger.Balanced( 2 ) );
+
+    Object object;
+    CHECK( SyncWait( object.Add( std::allocator_arg, Counting<long>( ledger ), 1 ) ) == 101 );
+    CHECK( ledger.Balanced( 3 ) );
+
+    auto lambda = [ factor = 7 ]( std::allocator_arg_t, Counting<char>, int value ) -> Task<int> {
+        co_return factor * value;
+    };
+    {
+        auto task = lambda( std::allocator_arg, Counting<char>( ledger ), 3 );
+        CHECK( ledger.m_allocations.load() == 4 && ledger.m_deallocations.load() == 3 );
+        CHECK( SyncWait( task ) == 21 );
+    }
+    CHECK( ledger.Balanced( 4 ) );
+
+    // Never started.
+    {
+        auto task = Leaf( std::allocator_arg, Counting<char>( ledger ), 1 );
+    }
+    CHECK( ledger.Balanced( 5 ) );
+}
+
+// A frame created on one thread is freed on another, through the same allocator.
+auto CrossThreadFree() -> void {
+    Ledger ledger;
+    auto tp = std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 2 } );
+
+    auto onPool = [ & ]( std::allocator_arg_t, Counting<char>, int value ) -> Task<int> {
+        co_await tp->Schedule();
+        co_return value + 1;
+    };
+    for( int i = 0; i < 100; ++i ) {
+        auto task = onPool( std::allocator_arg, Counting<char>( ledger ), i );
+        CHECK( SyncWait( task ) == i + 1 );
+        std::thread { [ moved = std::move( task ) ]() mutable {
+            auto destroyed = std::move( moved );
+        } }.join();
+    }
+    CHECK( ledger.Balanced( 100 ) );
+
+    // Completed on the pool and held by WhenAll's tasks, whose frames and list come from the
+    // allocator too.
+    {
+        std::vector<Task<int>> tasks;
+        for( int i = 0; i < 100; ++i ) {
+            tasks.emplace_back( onPool( std::allocator_arg, Counting<char>( ledger ), i ) );
+        }
+        auto results = SyncWait( WhenAll( std::allocator_arg, Counting<char>( ledger ), std::move( tasks ) ) );
+        CHECK( results.size() == 100 && results[ 99 ].return_value() == 100 );
+    }
+    CHECK( ledger.m_allocations.load() == ledger.m_deallocations.load() && ledger.m_allocated.load() == ledger.m_deallocated.load() );
+}
+
+// A frame from an allocator goes back to it, not to the FrameArena current when it was
+// created, which may be gone by then.
+auto InsideArena() -> void {
+    Ledger ledger;
+    Task<int> task;
+    {
+        FrameArena arena;
+        task = arena.Create( [ & ] { return Leaf( std::allocator_arg, Counting<char>( ledger ), 9 ); } );
+        CHECK( ledger.m_allocations.load() == 1 );
+    }
+    CHECK( SyncWait( task ) == 9 );
+    task = Task<int> {};
+    CHECK( ledger.Balanced( 1 ) );
+}
+
+}
+
+auto main() -> int {
+    Paired();
+    CrossThreadFree();
+    InsideArena();
+    return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace Coroutines::Tests {
+
+[[noreturn]] inline auto Fail( const char* condition, const char* file, int line ) noexcept -> void {
+    std::fprintf( stderr, "%s:%d: CHECK( %s ) failed\n", file, line, condition );
+    std::abort();
+}
+
+// Distinct handles for the queue tests, never resumed.
+inline auto FakeHandle( std::uintptr_t index ) noexcept -> std::coroutine_handle<> {
+    return std::coroutine_handle<>::from_address( reinterpret_cast<void*>( ( index + 1 ) * 16 ) );
+}
+
+inline auto FakeIndex( std::coroutine_handle<> handle ) noexcept -> std::uintptr_t {
+    return reinterpret_cast<std::uintptr_t>( handle.address() ) / 16 - 1;
+}
+
+}
+
+// Works in release builds too, unlike assert().
+#define CHECK( condition ) ( ( condition ) ? void() : ::Coroutines::Tests::Fail( #condition, __FILE__, __LINE__ ) )
@@ -0,0 +1,89 @@
+#include "Check.h"
+
+#include <Coroutines/FrameAllocator.h>
+
+#include <barrier>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+namespace {
+
+constexpr std::size_t FRAME_SIZE = 100;
+
+// Frames freed on another thread count as remote frees and go back to the thread that
+// allocated them, which reuses them without new allocations.
+auto RemoteFreesReturnToOwner() -> void {
+    constexpr std::size_t COUNT = 1000;
+    const auto before = FrameAllocator::Metrics();
+
+    std::vector<void*> frames;
+    for( std::size_t i = 0; i < COUNT; ++i ) {
+        frames.emplace_back( FrameAllocator::Allocate( FRAME_SIZE ) );
+    }
+    CHECK( FrameAllocator::Metrics().frames_in_use == before.frames_in_use + COUNT );
+
+    std::thread { [ & ] {
+        for( auto* frame: frames ) {
+            FrameAllocator::Deallocate( frame );
+        }
+    } }.join();
+
+    const auto freed = FrameAllocator::Metrics();
+    CHECK( freed.frames_in_use == before.frames_in_use );
+    CHECK( freed.remote_frees == before.remote_frees + COUNT );
+
+    for( auto& frame: frames ) {
+        frame = FrameAllocator::Allocate( FRAME_SIZE );
+    }
+    CHECK( FrameAllocator::Metrics().misses == freed.misses );
+    for( auto* frame: frames ) {
+        FrameAllocator::Deallocate( frame );
+    }
+    CHECK( FrameAllocator::Metrics().frames_in_use == before.frames_in_use );
+}
+
+// Threads free each other's frames while allocating their own.
+auto ConcurrentRemoteFrees() -> void {
+    constexpr std::size_t THREADS = 4;
+    constexpr std::size_t COUNT = 500;
+    constexpr int ROUNDS = 50;
+    const auto before = FrameAllocator::Metrics();
+
+    std::vector<std::vector<void*>> frames( THREADS );
+    std::barrier sync { static_cast<std::ptrdiff_t>( THREADS ) };
+    std::vector<std::jthread> threads;
+    for( std::size_t t = 0; t < THREADS; ++t ) {
+        threads.emplace_back( [ &, t ] {
+            for( int round = 0; round < ROUNDS; ++round ) {
+                for( std::size_t i = 0; i < COUNT; ++i ) {
+                    frames[ t ].emplace_back( FrameAllocator::Allocate( FRAME_SIZE + i % 512 ) );
+                }
+                sync.arrive_and_wait();
+
+                auto& other = frames[ ( t + 1 ) % THREADS ];
+                for( auto* frame: other ) {
+                    FrameAllocator::Deallocate( frame );
+                }
+                other.clear();
+                sync.arrive_and_wait();
+            }
+        } );
+    }
+    threads.clear();
+
+    const auto after = FrameAllocator::Metrics();
+    CHECK( after.frames_in_use == before.frames_in_use );
+    CHECK( after.remote_frees == before.remote_frees + THREADS * COUNT * ROUNDS );
+}
+
+}
+
+auto main() -> int {
+    RemoteFreesReturnToOwner();
+    ConcurrentRemoteFrees();
+    return 0;
+}
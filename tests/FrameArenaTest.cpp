@@ -0,0 +1,183 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+using Private::FrameArenaState;
+
+namespace {
+
+// Frames in use by the FrameAllocator, which arena frames do not count in.
+auto HeapFrames() -> std::uint64_t {
+#ifdef COROUTINES_FRAME_RECYCLING
+    return FrameAllocator::Metrics().frames_in_use;
+#else
+    return 0;
+#endif
+}
+
+// The arena Create() makes current, which the Tasks of its tree install while they run.
+auto StateOf( FrameArena& arena ) -> FrameArenaState* {
+    return arena.Create( [] { return FrameArenaState::Current(); } );
+}
+
+auto Leaf( int value ) -> Task<int> {
+    co_return value;
+}
+
+// Children are created with the arena current and get their frames from it.
+auto Tree() -> void {
+    FrameArena arena;
+    auto* state = StateOf( arena );
+
+    auto root = [ & ]() -> Task<int> {
+        CHECK( FrameArenaState::Current() == state );
+        const auto before = HeapFrames();
+        int sum = 0;
+        for( int i = 0; i < 100; ++i ) {
+            auto leaf = Leaf( i );
+            CHECK( HeapFrames() == before );
+            sum += co_await leaf;
+            CHECK( FrameArenaState::Current() == state );
+        }
+        co_return sum;
+    };
+    CHECK( SyncWait( arena.Create( root ) ) == 4950 );
+    CHECK( FrameArenaState::Current() == nullptr );
+}
+
+// An await that completes without suspending leaves the arena installed, the next one that
+// suspends hands the thread back without it. The same goes for both operands of a sum, which
+// may suspend one after the other before either resumes.
+auto ReadyAwait() -> void {
+    auto root = []() -> Task<int> {
+        co_await std::suspend_never {};
+        co_await std::suspend_always {};
+        co_return 1;
+    };
+    {
+        FrameArena arena;
+        auto task = arena.Create( root );
+        CHECK( FrameArenaState::Current() == nullptr );
+        task.resume();
+        CHECK( FrameArenaState::Current() == nullptr );
+    }
+    // Would come from the destroyed arena had it stayed current.
+    auto other = Leaf( 2 );
+    CHECK( SyncWait( std::move( other ) ) == 2 );
+
+    auto sum = []() -> Task<int> {
+        co_return co_await Leaf( 1 ) + co_await Leaf( 2 );
+    };
+    {
+        FrameArena arena;
+        CHECK( SyncWait( arena.Create( sum ) ) == 3 );
+        CHECK( FrameArenaState::Current() == nullptr );
+    }
+}
+
+// A Task of one arena creating a tree in another gets its own arena back once that is done.
+auto Nested() -> void {
+    FrameArena outer;
+    auto* outerState = StateOf( outer );
+
+    auto root = [ & ]() -> Task<int> {
+        FrameArena inner;
+        auto* innerState = StateOf( inner );
+        CHECK( innerState != outerState && FrameArenaState::Current() == outerState );
+
+        auto child = [ & ]() -> Task<int> {
+            CHECK( FrameArenaState::Current() == innerState );
+            co_await std::suspend_never {};
+            const int value = co_await Leaf( 1 );
+            CHECK( FrameArenaState::Current() == innerState );
+            co_return value;
+        };
+        const int value = co_await inner.Create( child );
+        CHECK( FrameArenaState::Current() == outerState );
+        co_return value + co_await Leaf( 2 );
+    };
+    CHECK( SyncWait( outer.Create( root ) ) == 3 );
+    CHECK( FrameArenaState::Current() == nullptr );
+}
+
+// Frames freed on other threads, some after the arena is gone, release their blocks.
+auto CrossThreadFrees() -> void {
+    constexpr int COUNT = 1000;
+    std::vector<Task<int>> tasks;
+    {
+        // Small blocks, most are retired while their frames are still alive.
+        FrameArena arena { FrameArena::options { .block_size = 1024 } };
+        for( int i = 0; i < COUNT; ++i ) {
+            tasks.emplace_back( arena.Create( Leaf, i ) );
+        }
+
+        std::vector<Task<int>> half( std::make_move_iterator( tasks.begin() ), std::make_move_iterator( tasks.begin() + COUNT / 2 ) );
+        std::thread { [ &half ] {
+            for( auto& task: half ) {
+                task.resume();
+                CHECK( task.is_ready() );
+            }
+            half.clear();
+        } }.join();
+    }
+
+    std::thread { [ &tasks ] {
+        long sum = 0;
+        for( int i = COUNT / 2; i < COUNT; ++i ) {
+            tasks[ i ].resume();
+            sum += tasks[ i ].promise().result();
+        }
+        CHECK( sum == ( COUNT / 2 + COUNT - 1 ) * ( COUNT / 2 ) / 2 );
+        tasks.clear();
+    } }.join();
+}
+
+// A Task resumed on other threads outlives its arena and completes after it is gone.
+auto Teardown() -> void {
+    auto tp = std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 2 } );
+    for( int round = 0; round < 100; ++round ) {
+        Event started;
+        Event go;
+        auto root = [ & ]() -> Task<int> {
+            auto child = Leaf( 1 );
+            co_await tp->Schedule();
+            started.Set();
+            co_await go;
+            // The arena is gone, children come from the heap now.
+            co_return co_await child + co_await Leaf( 2 );
+        };
+
+        auto arena = std::make_unique<FrameArena>();
+        auto task = arena->Create( root );
+        auto waiter = [ & ]() -> Task<int> {
+            co_return co_await task;
+        };
+        auto result = std::jthread { [ & ] {
+            CHECK( SyncWait( waiter() ) == 3 );
+        } };
+        SyncWait( [ & ]() -> Task<void> {
+            co_await started;
+        }() );
+        arena.reset();
+        go.Set();
+    }
+}
+
+}
+
+auto main() -> int {
+    Tree();
+    ReadyAwait();
+    Nested();
+    CrossThreadFrees();
+    Teardown();
+    return 0;
+}
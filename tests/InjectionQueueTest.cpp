@@ -0,0 +1,124 @@
+#include "Check.h"
+
+#include <Coroutines/Private/InjectionQueue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+namespace {
+
+// Handles queued after the ring filled up must not overtake the ones in the overflow list.
+auto OverflowOrder() -> void {
+    Private::InjectionQueue queue { 4 };
+    std::int64_t stamp = 0;
+    for( std::uintptr_t i = 0; i < 10; ++i ) {
+        queue.Push( FakeHandle( i ), static_cast<std::int64_t>( i ) );
+    }
+    CHECK( queue.OverflowPushes() == 6 );
+    CHECK( queue.size() == 10 );
+
+    CHECK( queue.Pop( stamp ) == FakeHandle( 0 ) && stamp == 0 );
+    CHECK( queue.Pop( stamp ) == FakeHandle( 1 ) && stamp == 1 );
+    for( std::uintptr_t i = 10; i < 13; ++i ) {
+        queue.Push( FakeHandle( i ), static_cast<std::int64_t>( i ) );
+    }
+
+    for( std::uintptr_t i = 2; i < 13; ++i ) {
+        CHECK( queue.Pop( stamp ) == FakeHandle( i ) && stamp == static_cast<std::int64_t>( i ) );
+        // The ring has room again but the overflow list still holds 9 to 12.
+        if( i == 8 ) {
+            queue.Push( FakeHandle( 13 ), 13 );
+        }
+    }
+    CHECK( queue.Pop( stamp ) == FakeHandle( 13 ) );
+    CHECK( queue.Pop( stamp ) == nullptr );
+    CHECK( queue.empty() );
+
+    // Back on the lock-free path.
+    const auto overflowPushes = queue.OverflowPushes();
+    queue.Push( FakeHandle( 0 ) );
+    CHECK( queue.OverflowPushes() == overflowPushes );
+}
+
+// Every producer's handles come out in the order it pushed them while the ring keeps overflowing.
+auto ProducerOrder() -> void {
+    constexpr std::uintptr_t PER_PRODUCER = 50000;
+    constexpr std::uintptr_t PRODUCERS = 4;
+
+    Private::InjectionQueue queue { 8 };
+    std::vector<std::thread> producers;
+    for( std::uintptr_t p = 0; p < PRODUCERS; ++p ) {
+        producers.emplace_back( [ &queue, p ] {
+            for( std::uintptr_t i = 0; i < PER_PRODUCER; ++i ) {
+                queue.Push( FakeHandle( p * PER_PRODUCER + i ) );
+            }
+        } );
+    }
+
+    std::vector<std::uintptr_t> next( PRODUCERS, 0 );
+    std::int64_t stamp = 0;
+    for( std::uintptr_t popped = 0; popped < PRODUCERS * PER_PRODUCER; ) {
+        if( auto handle = queue.Pop( stamp ); handle != nullptr ) {
+            const auto index = FakeIndex( handle );
+            CHECK( index % PER_PRODUCER == next[ index / PER_PRODUCER ]++ );
+            ++popped;
+        }
+    }
+
+    for( auto& producer: producers ) {
+        producer.join();
+    }
+    CHECK( queue.empty() );
+    CHECK( queue.OverflowPushes() > 0 );
+}
+
+auto ExactlyOnce() -> void {
+    constexpr std::uintptr_t PER_PRODUCER = 50000;
+    constexpr std::uintptr_t PRODUCERS = 4;
+    constexpr int CONSUMERS = 3;
+
+    Private::InjectionQueue queue { 16 };
+    std::vector<std::atomic<int>> taken( PRODUCERS * PER_PRODUCER );
+    std::atomic<std::uintptr_t> popped { 0 };
+
+    std::vector<std::thread> threads;
+    for( std::uintptr_t p = 0; p < PRODUCERS; ++p ) {
+        threads.emplace_back( [ &queue, p ] {
+            for( std::uintptr_t i = 0; i < PER_PRODUCER; ++i ) {
+                queue.Push( FakeHandle( p * PER_PRODUCER + i ) );
+            }
+        } );
+    }
+    for( int c = 0; c < CONSUMERS; ++c ) {
+        threads.emplace_back( [ & ] {
+            std::int64_t stamp = 0;
+            while( popped.load( std::memory_order::relaxed ) < PRODUCERS * PER_PRODUCER ) {
+                if( auto handle = queue.Pop( stamp ); handle != nullptr ) {
+                    CHECK( taken[ FakeIndex( handle ) ].fetch_add( 1, std::memory_order::relaxed ) == 0 );
+                    popped.fetch_add( 1, std::memory_order::relaxed );
+                }
+            }
+        } );
+    }
+
+    for( auto& thread: threads ) {
+        thread.join();
+    }
+    CHECK( queue.empty() );
+    for( auto& count: taken ) {
+        CHECK( count.load() == 1 );
+    }
+}
+
+}
+
+int main() {
+    OverflowOrder();
+    ProducerOrder();
+    ExactlyOnce();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+namespace {
+
+// A file in the temporary directory, removed with the object.
+struct TempFile {
+    TempFile()
+        : m_path( ( std::filesystem::temp_directory_path() / ( "IoUringContextTest." + std::to_string( ::getpid() ) ) ).string() ) {
+    }
+    ~TempFile() {
+        ::unlink( this->m_path.c_str() );
+    }
+
+    std::string m_path;
+};
+
+auto Bytes( const char* text ) -> std::span<const std::byte> {
+    return std::as_bytes( std::span { text, std::strlen( text ) } );
+}
+
+// Openat, Write, Fsync and Read a file back.
+auto RoundTrip() -> void {
+    TempFile file;
+    IoUringContext io;
+    auto task = [ & ]() -> Task<std::string> {
+        const int fd = co_await io.Openat( AT_FDCWD, file.m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+        CHECK( fd >= 0 );
+        CHECK( co_await io.Write( fd, Bytes( "hello uring" ), 0 ) == 11 );
+        co_await io.Fsync( fd );
+
+        std::byte buffer[ 64 ] {};
+        const auto read = co_await io.Read( fd, buffer, 6 );
+        ::close( fd );
+        co_return std::string( reinterpret_cast<const char*>( buffer ), read );
+    };
+    CHECK( io.RunUntil( task() ) == "uring" );
+
+    // Errors surface from co_await.
+    auto missing = [ & ]() -> Task<int> {
+        try {
+            co_await io.Openat( AT_FDCWD, "/nonexistent/IoUringContextTest", O_RDONLY );
+        } catch( const std::system_error& error ) {
+            co_return error.code().value();
+        }
+        co_return 0;
+    };
+    CHECK( io.RunUntil( missing() ) == ENOENT );
+}
+
+// WriteFixed from one registered buffer and ReadFixed into another, an index past the
+// registration fails without reaching the kernel.
+auto FixedBuffers() -> void {
+    TempFile file;
+    IoUringContext io { IoUringContext::options { .queue_depth = 8, .registered_buffers = 2, .registered_buffer_size = 4096, .inbox_capacity = 64 } };
+    CHECK( io.RegisteredBuffers() == 2 );
+
+    auto in = io.RegisteredBuffer( 0 );
+    for( std::size_t i = 0; i < in.size(); ++i ) {
+        in[ i ] = static_cast<std::byte>( i * 7 );
+    }
+    auto task = [ & ]() -> Task<bool> {
+        const int fd = co_await io.Openat( AT_FDCWD, file.m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+        CHECK( co_await io.WriteFixed( fd, 0, 4096, 0 ) == 4096 );
+        CHECK( co_await io.ReadFixed( fd, 1, 1000, 100 ) == 1000 );
+
+        int rejected = 0;
+        try {
+            co_await io.ReadFixed( fd, 2, 16, 0 );
+        } catch( const std::system_error& error ) {
+            rejected = error.code().value();
+        }
+        CHECK( rejected == EINVAL );
+        // Would pass as buffer 1 truncated to the 16 bits of buf_index.
+        rejected = 0;
+        try {
+            co_await io.WriteFixed( fd, 65536 + 1, 16, 0 );
+        } catch( const std::system_error& error ) {
+            rejected = error.code().value();
+        }
+        CHECK( rejected == EINVAL );
+        ::close( fd );
+        co_return true;
+    };
+    CHECK( io.RunUntil( task() ) );
+
+    auto out = io.RegisteredBuffer( 1 );
+    CHECK( std::equal( out.begin(), out.begin() + 1000, in.begin() + 100 ) );
+}
+
+// More operations prepared in one round than the submission queue holds.
+auto FullQueue() -> void {
+    TempFile file;
+    IoUringContext io { IoUringContext::options { .queue_depth = 4, .registered_buffers = 0, .registered_buffer_size = 0, .inbox_capacity = 64 } };
+    constexpr std::size_t COUNT = 100;
+
+    const int fd = ::open( file.m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+    CHECK( fd >= 0 );
+    std::vector<std::byte> bytes( COUNT );
+    for( std::size_t i = 0; i < COUNT; ++i ) {
+        bytes[ i ] = static_cast<std::byte>( i );
+    }
+    CHECK( ::pwrite( fd, bytes.data(), bytes.size(), 0 ) == COUNT );
+
+    auto readAt = [ & ]( std::size_t offset ) -> Task<int> {
+        std::byte byte {};
+        CHECK( co_await io.Read( fd, { &byte, 1 }, offset ) == 1 );
+        co_return static_cast<int>( byte );
+    };
+    std::vector<Task<int>> reads;
+    for( std::size_t i = 0; i < COUNT; ++i ) {
+        reads.emplace_back( readAt( i ) );
+    }
+    auto results = io.RunUntil( WhenAll( std::move( reads ) ) );
+    for( std::size_t i = 0; i < COUNT; ++i ) {
+        CHECK( results[ i ].return_value() == static_cast<int>( i ) );
+    }
+    ::close( fd );
+}
+
+// I/O awaited on pool threads is handed over to the loop and resumes there.
+auto FromOtherThread() -> void {
+    IoUringContext io;
+    auto tp = std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 2 } );
+    int fds[ 2 ];
+    CHECK( ::pipe( fds ) == 0 );
+
+    auto task = [ & ]() -> Task<std::size_t> {
+        std::size_t total = 0;
+        for( int i = 0; i < 100; ++i ) {
+            co_await tp->Schedule();
+            CHECK( !io.IsLoopThread() );
+            total += co_await io.Write( fds[ 1 ], Bytes( "x" ) );
+            CHECK( io.IsLoopThread() );
+
+            co_await tp->Schedule();
+            std::byte byte {};
+            total += co_await io.Read( fds[ 0 ], { &byte, 1 } );
+            CHECK( io.IsLoopThread() && byte == std::byte { 'x' } );
+        }
+        co_return total;
+    };
+    CHECK( io.RunUntil( task() ) == 200 );
+    ::close( fds[ 0 ] );
+    ::close( fds[ 1 ] );
+}
+
+// A read of a pipe nobody writes to is cancelled when the context goes.
+auto DestroyWithPendingRead() -> void {
+    int fds[ 2 ];
+    CHECK( ::pipe( fds ) == 0 );
+    bool resumed = false;
+
+    // Outlives the context, whose destruction completes the read in its frame.
+    Task<void> reader;
+    {
+        IoUringContext io;
+        auto read = [ & ]() -> Task<void> {
+            std::byte buffer[ 8 ];
+            co_await io.Read( fds[ 0 ], buffer );
+            resumed = true;
+        };
+        reader = read();
+        io.resume( reader.handle() );
+        // A round for the reader to submit its read, which the loop does not wait for.
+        auto round = [ & ]() -> Task<void> {
+            co_await io.Schedule();
+        };
+        io.RunUntil( round() );
+    }
+    CHECK( !resumed && !reader.is_ready() );
+    ::close( fds[ 0 ] );
+    ::close( fds[ 1 ] );
+}
+
+}
+
+auto main() -> int {
+    RoundTrip();
+    FixedBuffers();
+    FullQueue();
+    FromOtherThread();
+    DestroyWithPendingRead();
+    return 0;
+}
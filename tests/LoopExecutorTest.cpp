@@ -0,0 +1,82 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Coroutines queued from the loop thread run, and the ones they queue, before RunUntilIdle()
+// returns.
+auto RunUntilIdle() -> void {
+    LoopExecutor loop;
+    int steps = 0;
+    auto task = [ & ]() -> Task<void> {
+        for( int i = 0; i < 10; ++i ) {
+            co_await loop.yield();
+            CHECK( loop.IsLoopThread() );
+            ++steps;
+        }
+    };
+    auto first = task();
+    auto second = task();
+    loop.resume( first.handle() );
+    loop.resume( second.handle() );
+    CHECK( loop.RunUntilIdle() == 22 );
+    CHECK( steps == 20 && first.is_ready() && second.is_ready() && !loop.IsLoopThread() );
+    CHECK( loop.RunUntilIdle() == 0 );
+}
+
+// resume() from another thread wakes a loop blocked in Wait().
+auto CrossThreadResume() -> void {
+    LoopExecutor loop;
+    auto tp = std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 2 } );
+    std::atomic<int> delayed { 0 };
+
+    auto task = [ & ]() -> Task<int> {
+        int total = 0;
+        for( int i = 0; i < 1000; ++i ) {
+            co_await tp->Schedule();
+            CHECK( !loop.IsLoopThread() );
+            // Now and then, long enough for the loop to block.
+            if( i % 100 == 0 ) {
+                std::this_thread::sleep_for( 5ms );
+                delayed.fetch_add( 1 );
+            }
+            co_await loop.Schedule();
+            CHECK( loop.IsLoopThread() );
+            ++total;
+        }
+        co_return total;
+    };
+    CHECK( loop.RunUntil( task() ) == 1000 );
+    CHECK( delayed.load() == 10 );
+
+    // A plain thread resuming a coroutine suspended outside the loop.
+    Event event;
+    auto waiter = [ & ]() -> Task<bool> {
+        co_await event;
+        co_await loop.Schedule();
+        co_return loop.IsLoopThread();
+    };
+    std::jthread setter { [ & ] {
+        std::this_thread::sleep_for( 50ms );
+        event.Set();
+    } };
+    CHECK( loop.RunUntil( waiter() ) );
+}
+
+}
+
+auto main() -> int {
+    RunUntilIdle();
+    CrossThreadResume();
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+using namespace std::chrono_literals;
+
+namespace {
+
+// A connected pair of non-blocking stream sockets.
+struct SocketPair {
+    SocketPair() {
+        CHECK( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, this->m_fds ) == 0 );
+    }
+    ~SocketPair() {
+        ::close( this->m_fds[ 0 ] );
+        ::close( this->m_fds[ 1 ] );
+    }
+
+    int m_fds[ 2 ];
+};
+
+auto Send( int fd, std::size_t count ) -> void {
+    const std::string bytes( count, 'x' );
+    CHECK( ::write( fd, bytes.data(), bytes.size() ) == static_cast<ssize_t>( count ) );
+}
+
+// Reads until EAGAIN, returns how many bytes came.
+auto Drain( int fd ) -> std::size_t {
+    std::size_t total = 0;
+    char buffer[ 4096 ];
+    ssize_t read = 0;
+    while( ( read = ::read( fd, buffer, sizeof( buffer ) ) ) > 0 ) {
+        total += static_cast<std::size_t>( read );
+    }
+    return total;
+}
+
+// Readiness operations are awaited from a Task, which SyncWait() takes.
+auto AwaitReadable( Reactor& reactor, int fd ) -> Task<void> {
+    co_await reactor.Readable( fd );
+}
+
+auto AwaitWritable( Reactor& reactor, int fd ) -> Task<void> {
+    co_await reactor.Writable( fd );
+}
+
+// A writer filling the socket until EAGAIN against a reader emptying it, each awaiting
+// readiness when it cannot go on.
+auto PingPong( std::shared_ptr<ThreadPool> tp ) -> void {
+    constexpr std::size_t TOTAL = 4 << 20;
+    Reactor reactor { tp };
+    SocketPair sockets;
+
+    auto writer = [ & ]() -> Task<void> {
+        co_await reactor.Schedule();
+        const std::string chunk( 16384, 'x' );
+        std::size_t sent = 0;
+        while( sent < TOTAL ) {
+            const auto written = ::write( sockets.m_fds[ 0 ], chunk.data(), std::min( chunk.size(), TOTAL - sent ) );
+            if( written > 0 ) {
+                sent += static_cast<std::size_t>( written );
+                continue;
+            }
+            CHECK( errno == EAGAIN );
+            co_await reactor.Writable( sockets.m_fds[ 0 ] );
+            CHECK( tp == nullptr ? reactor.IsReactorThread() : tp->IsWorkerThread() );
+        }
+    };
+    auto reader = [ & ]() -> Task<std::size_t> {
+        co_await reactor.Schedule();
+        std::size_t received = 0;
+        while( received < TOTAL ) {
+            received += Drain( sockets.m_fds[ 1 ] );
+            if( received < TOTAL ) {
+                co_await reactor.Readable( sockets.m_fds[ 1 ] );
+            }
+        }
+        co_return received;
+    };
+    auto [ wrote, read ] = SyncWait( WhenAll( writer(), reader() ) );
+    CHECK( read.return_value() == TOTAL );
+    reactor.Remove( sockets.m_fds[ 0 ] );
+    reactor.Remove( sockets.m_fds[ 1 ] );
+}
+
+// Readiness reported before the await completes it right away and is consumed by it, the
+// next await waits for new data.
+auto ReadinessBeforeAwait() -> void {
+    Reactor reactor;
+    SocketPair sockets;
+    const int fd = sockets.m_fds[ 1 ];
+
+    // Registers the fd, a fresh socket is writable.
+    SyncWait( AwaitWritable( reactor, fd ) );
+    Send( sockets.m_fds[ 0 ], 10 );
+    std::this_thread::sleep_for( 50ms );
+
+    SyncWait( AwaitReadable( reactor, fd ) );
+
+    // The data was not read, edge-triggered epoll reports nothing new.
+    std::atomic<bool> woken { false };
+    std::jthread waiter { [ & ] {
+        SyncWait( AwaitReadable( reactor, fd ) );
+        woken.store( true );
+    } };
+    std::this_thread::sleep_for( 50ms );
+    CHECK( !woken.load() );
+
+    Send( sockets.m_fds[ 0 ], 10 );
+    waiter.join();
+    CHECK( woken.load() && Drain( fd ) == 20 );
+    reactor.Remove( fd );
+}
+
+// Remove() wakes the coroutine waiting on the fd.
+auto RemoveWakesWaiter() -> void {
+    for( auto tp: { std::shared_ptr<ThreadPool> {}, std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 1 } ) } ) {
+        Reactor reactor { tp };
+        SocketPair sockets;
+        const int fd = sockets.m_fds[ 1 ];
+
+        std::atomic<bool> woken { false };
+        std::jthread waiter { [ & ] {
+            SyncWait( AwaitReadable( reactor, fd ) );
+            woken.store( true );
+        } };
+        std::this_thread::sleep_for( 50ms );
+        CHECK( !woken.load() );
+
+        reactor.Remove( fd );
+        waiter.join();
+        CHECK( woken.load() );
+    }
+}
+
+// epoll refuses regular files.
+auto RegularFile() -> void {
+    Reactor reactor;
+    const auto path = ( std::filesystem::temp_directory_path() / ( "ReactorTest." + std::to_string( ::getpid() ) ) ).string();
+    const int fd = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600 );
+    CHECK( fd >= 0 );
+    ::unlink( path.c_str() );
+
+    bool thrown = false;
+    try {
+        static_cast<void>( reactor.Readable( fd ) );
+    } catch( const std::system_error& error ) {
+        thrown = error.code().value() == EPERM;
+    }
+    CHECK( thrown );
+    ::close( fd );
+}
+
+// Coroutines resumed right before the reactor goes still run.
+auto DestroyRunsPending() -> void {
+    for( int round = 0; round < 100; ++round ) {
+        int ran = 0;
+        auto step = [ & ]() -> Task<void> {
+            ++ran;
+            co_return;
+        };
+        auto first = step();
+        auto second = step();
+        {
+            Reactor reactor;
+            reactor.resume( first.handle() );
+            reactor.resume( second.handle() );
+        }
+        CHECK( ran == 2 && first.is_ready() && second.is_ready() );
+    }
+}
+
+}
+
+auto main() -> int {
+    PingPong( nullptr );
+    PingPong( std::make_shared<ThreadPool>( ThreadPool::options { .thread_count = 2 } ) );
+    ReadinessBeforeAwait();
+    RemoveWakesWaiter();
+    RegularFile();
+    DestroyRunsPending();
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace Coroutines::Tests;
+
+namespace {
+
+auto MakePool( uint32_t threads ) -> std::shared_ptr<ThreadPool> {
+    ThreadPool::options opts {};
+    opts.thread_count = threads;
+    return std::make_shared<ThreadPool>( opts );
+}
+
+// Handles resumed through the strand from one thread run in that order, one at a time.
+auto Ordering() -> void {
+    auto tp = MakePool( 4 );
+    Strand<ThreadPool> strand { tp };
+    constexpr int COUNT = 10000;
+
+    std::vector<int> order;
+    std::atomic<int> inside { 0 };
+    auto step = [ & ]( int id ) -> Task<void> {
+        CHECK( strand.IsRunningOnStrand() );
+        CHECK( inside.fetch_add( 1, std::memory_order::relaxed ) == 0 );
+        order.emplace_back( id );
+        inside.fetch_sub( 1, std::memory_order::relaxed );
+        co_return;
+    };
+
+    std::vector<Task<void>> steps;
+    steps.reserve( COUNT );
+    for( int i = 0; i < COUNT; ++i ) {
+        steps.emplace_back( step( i ) );
+    }
+    auto poster = [ & ]() -> Task<void> {
+        co_await tp->Schedule();
+        for( auto& s: steps ) {
+            strand.resume( s.handle() );
+        }
+        co_await strand.Schedule();
+    };
+    SyncWait( poster() );
+
+    CHECK( order.size() == COUNT );
+    for( int i = 0; i < COUNT; ++i ) {
+        CHECK( order[ i ] == i );
+    }
+}
+
+// Coroutines from many threads hopping on and off the strand never overlap on it.
+auto Exclusion() -> void {
+    auto tp = MakePool( 4 );
+    Strand<ThreadPool> strand { tp };
+    long counter = 0;
+    std::atomic<int> inside { 0 };
+
+    auto worker = [ & ]( int rounds ) -> Task<void> {
+        for( int i = 0; i < rounds; ++i ) {
+            co_await tp->Schedule();
+            co_await strand.Schedule();
+            CHECK( inside.fetch_add( 1, std::memory_order::relaxed ) == 0 );
+            ++counter;
+            inside.fetch_sub( 1, std::memory_order::relaxed );
+        }
+    };
+
+    std::vector<Task<void>> workers;
+    for( int i = 0; i < 16; ++i ) {
+        workers.emplace_back( worker( 500 ) );
+    }
+    SyncWait( WhenAll( std::move( workers ) ) );
+    CHECK( counter == 16 * 500 );
+}
+
+// The strand is destroyed right after its last handle ran, while the drain loop may still
+// be parking on a worker.
+auto DestroyAfterLastHandle() -> void {
+    auto tp = MakePool( 2 );
+    for( int i = 0; i < 2000; ++i ) {
+        auto strand = std::make_unique<Strand<ThreadPool>>( tp );
+        auto task = [ & ]() -> Task<int> {
+            co_await tp->Schedule();
+            co_await strand->Schedule();
+            co_return 1;
+        };
+        CHECK( SyncWait( task() ) == 1 );
+        strand.reset();
+    }
+}
+
+}
+
+auto main() -> int {
+    Ordering();
+    Exclusion();
+    DestroyAfterLastHandle();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+using namespace Coroutines::Tests;
+using namespace std::chrono_literals;
+
+namespace {
+
+auto MakePool( uint32_t threads ) -> ThreadPool::options {
+    ThreadPool::options opts {};
+    opts.thread_count = threads;
+    return opts;
+}
+
+// A timed out Lock() leaves the waiter list, the next Unlock() does not hand the mutex to it.
+auto MutexWaiterLeaves() -> void {
+    ThreadPool tp { MakePool( 2 ) };
+    AsyncMutex mutex;
+    Event timedOut;
+
+    auto holder = [ & ]() -> Task<bool> {
+        co_await tp.Schedule();
+        auto lock = co_await mutex.Lock();
+        co_await timedOut;
+        co_await tp.Schedule();
+        co_return true;
+    };
+    auto waiter = [ & ]() -> Task<bool> {
+        co_await tp.ScheduleAfter( 5ms );
+        auto lock = co_await WithTimeout( tp, mutex.Lock(), 10ms );
+        timedOut.Set( tp );
+        co_return !lock.has_value();
+    };
+
+    auto [ held, waited ] = SyncWait( WhenAll( holder(), waiter() ) );
+    CHECK( held.return_value() && waited.return_value() );
+    CHECK( mutex.TryLock() );
+    mutex.Unlock();
+}
+
+// Waiters queued behind an abandoned one still get the lock, in order.
+auto MutexOrderAfterAbandon() -> void {
+    ThreadPool tp { MakePool( 1 ) };
+    AsyncMutex mutex;
+    CHECK( mutex.TryLock() );
+
+    std::vector<int> order;
+    auto waiter = [ & ]( int id, std::chrono::milliseconds timeout ) -> Task<void> {
+        co_await tp.Schedule();
+        if( auto lock = co_await WithTimeout( tp, mutex.Lock(), timeout ) ) {
+            order.emplace_back( id );
+        }
+    };
+    auto unlocker = [ & ]() -> Task<void> {
+        co_await tp.ScheduleAfter( 30ms );
+        mutex.Unlock();
+    };
+
+    SyncWait( WhenAll( waiter( 1, 10s ), waiter( 2, 5ms ), waiter( 3, 10s ), unlocker() ) );
+    CHECK( ( order == std::vector<int> { 1, 3 } ) );
+    CHECK( mutex.TryLock() );
+    mutex.Unlock();
+}
+
+// Deadlines of 0 to 2ms race with releases on a single worker, no permit or lock may get lost.
+auto Churn() -> void {
+    constexpr int COROUTINES = 8;
+    constexpr int ROUNDS = 100;
+
+    ThreadPool tp { MakePool( 1 ) };
+    Semaphore semaphore { 2, 2 };
+    AsyncMutex mutex;
+    std::atomic<int> acquired { 0 };
+    std::atomic<int> timedOut { 0 };
+
+    auto churn = [ & ]() -> Task<void> {
+        co_await tp.Schedule();
+        for( int i = 0; i < ROUNDS; ++i ) {
+            const auto timeout = std::chrono::milliseconds { i % 3 };
+            if( co_await WithTimeout( tp, semaphore.Acquire(), timeout ) ) {
+                co_await tp.yield();
+                semaphore.Release();
+                acquired.fetch_add( 1, std::memory_order::relaxed );
+            } else {
+                timedOut.fetch_add( 1, std::memory_order::relaxed );
+            }
+
+            if( auto lock = co_await WithTimeout( tp, mutex.Lock(), timeout ) ) {
+                co_await tp.yield();
+            }
+        }
+    };
+
+    std::vector<Task<void>> tasks;
+    for( int i = 0; i < COROUTINES; ++i ) {
+        tasks.emplace_back( churn() );
+    }
+    SyncWait( WhenAll( std::move( tasks ) ) );
+
+    CHECK( acquired.load() + timedOut.load() == COROUTINES * ROUNDS );
+    CHECK( acquired.load() > 0 );
+    CHECK( semaphore.value() == 2 );
+    CHECK( mutex.TryLock() );
+    mutex.Unlock();
+}
+
+}
+
+int main() {
+    MutexWaiterLeaves();
+    MutexOrderAfterAbandon();
+    Churn();
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "Check.h"
+
+#include <Coroutines/Private/TimerWheel.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace Coroutines::Private;
+using namespace Coroutines::Tests;
+
+namespace {
+
+// Last level's reach, see TimerWheel.h.
+constexpr std::int64_t RANGE = std::int64_t { 1 } << 36;
+
+struct Timer : TimerNode {
+    std::int64_t m_firedAt { -1 };
+};
+
+// Steps through the wheel by its own NextDeadline(), checking every timer fires at the first
+// step that reached its tick. Returns the steps taken.
+auto RunToEmpty( TimerWheel& wheel, std::int64_t now ) -> std::size_t {
+    std::size_t steps = 0;
+    while( !wheel.empty() ) {
+        const auto next = wheel.NextDeadline();
+        CHECK( next != TimerWheel::NO_DEADLINE );
+        for( auto* node = wheel.Advance( next ); node != nullptr; node = node->m_next ) {
+            auto& timer = static_cast<Timer&>( *node );
+            CHECK( timer.m_firedAt == -1 );
+            CHECK( timer.m_tick <= next && timer.m_tick > now );
+            timer.m_firedAt = next;
+        }
+        // The wheel starts at its construction time, its first cascades may lie before now.
+        now = std::max( now, next );
+        ++steps;
+    }
+    return steps;
+}
+
+// Deadlines on every level fire on time after cascading down, in any insertion order.
+auto Cascade() -> void {
+    TimerWheel wheel;
+    const auto base = TimerWheel::NowTick();
+
+    std::vector<std::int64_t> deltas { 1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 262143, 262144, 262145, ( 1 << 24 ) + 7, ( std::int64_t { 1 } << 30 ) + 3 };
+    std::uint64_t seed = 0x9e3779b97f4a7c15;
+    for( int i = 0; i < 2000; ++i ) {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        deltas.emplace_back( static_cast<std::int64_t>( ( seed >> 33 ) % ( std::uint64_t { 1 } << ( 1 + i % 32 ) ) ) + 1 );
+    }
+
+    std::vector<Timer> timers( deltas.size() );
+    for( std::size_t i = 0; i < timers.size(); ++i ) {
+        timers[ i ].m_tick = base + deltas[ i ];
+        wheel.Insert( timers[ i ] );
+    }
+    CHECK( wheel.size() == timers.size() );
+
+    RunToEmpty( wheel, base );
+    for( auto& timer: timers ) {
+        CHECK( timer.m_firedAt == timer.m_tick );
+        CHECK( !timer.m_linked );
+    }
+}
+
+// Advancing in coarse jumps fires everything due and nothing later.
+auto CoarseAdvance() -> void {
+    TimerWheel wheel;
+    const auto base = TimerWheel::NowTick();
+    std::vector<Timer> timers( 5000 );
+    for( std::size_t i = 0; i < timers.size(); ++i ) {
+        timers[ i ].m_tick = base + static_cast<std::int64_t>( i * 37 % 100000 ) + 1;
+        wheel.Insert( timers[ i ] );
+    }
+
+    std::size_t fired = 0;
+    for( auto now = base; !wheel.empty(); ) {
+        now += 777;
+        for( auto* node = wheel.Advance( now ); node != nullptr; node = node->m_next ) {
+            CHECK( node->m_tick <= now && node->m_tick > now - 777 );
+            ++fired;
+        }
+        CHECK( wheel.empty() || wheel.NextDeadline() > now );
+    }
+    CHECK( fired == timers.size() );
+}
+
+// A timer removed after it cascaded down a level does not fire.
+auto RemoveAfterCascade() -> void {
+    TimerWheel wheel;
+    const auto base = TimerWheel::NowTick();
+    Timer removed;
+    Timer kept;
+    removed.m_tick = base + 5000;
+    kept.m_tick = base + 5001;
+    wheel.Insert( removed );
+    wheel.Insert( kept );
+
+    CHECK( wheel.Advance( base + 4999 ) == nullptr );
+    CHECK( wheel.Remove( removed ) );
+    CHECK( !wheel.Remove( removed ) );
+    CHECK( wheel.size() == 1 );
+
+    auto* fired = wheel.Advance( base + 6000 );
+    CHECK( fired == &kept && fired->m_next == nullptr );
+    CHECK( !wheel.Remove( kept ) );
+}
+
+// Deadlines past the wheel's range are clamped into the last level and re-inserted until
+// due, they never fire early.
+auto RangeClamp() -> void {
+    TimerWheel wheel;
+    const auto base = TimerWheel::NowTick();
+    Timer far;
+    Timer near;
+    far.m_tick = base + 3 * RANGE + 12345;
+    near.m_tick = base + 10;
+    wheel.Insert( far );
+    wheel.Insert( near );
+
+    const auto steps = RunToEmpty( wheel, base );
+    CHECK( near.m_firedAt == near.m_tick );
+    CHECK( far.m_firedAt == far.m_tick );
+    // A few re-insertions per range, not a step per slot.
+    CHECK( steps < 64 );
+
+    // A deadline at the end of time stays in the wheel as it advances.
+    Timer never;
+    never.m_tick = TimerWheel::NO_DEADLINE - 1;
+    wheel.Insert( never );
+    CHECK( wheel.NextDeadline() > base && wheel.NextDeadline() != TimerWheel::NO_DEADLINE );
+    CHECK( wheel.Advance( base + 2 * RANGE ) == nullptr );
+    CHECK( wheel.size() == 1 );
+    CHECK( wheel.Remove( never ) );
+    CHECK( wheel.empty() && wheel.NextDeadline() == TimerWheel::NO_DEADLINE );
+}
+
+auto TakeAll() -> void {
+    TimerWheel wheel;
+    const auto base = TimerWheel::NowTick();
+    std::vector<Timer> timers( 100 );
+    for( std::size_t i = 0; i < timers.size(); ++i ) {
+        timers[ i ].m_tick = base + static_cast<std::int64_t>( i ) * 1000;
+        wheel.Insert( timers[ i ] );
+    }
+
+    std::size_t taken = 0;
+    for( auto* node = wheel.TakeAll(); node != nullptr; node = node->m_next ) {
+        CHECK( !node->m_linked );
+        ++taken;
+    }
+    CHECK( taken == timers.size() );
+    CHECK( wheel.empty() && wheel.NextDeadline() == TimerWheel::NO_DEADLINE );
+}
+
+}
+
+auto main() -> int {
+    Cascade();
+    CoarseAdvance();
+    RemoveAfterCascade();
+    RangeClamp();
+    TakeAll();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "Check.h"
+
+#include <Coroutines/Async.h>
+
+#include <expected>
+#include <memory>
+#include <utility>
+
+using namespace Coroutines::Tests;
+
+namespace {
+
+enum class error { miss };
+
+// Counts the instances alive, to see locals of a frame go.
+struct Guard {
+    explicit Guard( int& alive ) noexcept
+        : m_alive( alive ) {
+        ++this->m_alive;
+    }
+    ~Guard() {
+        --this->m_alive;
+    }
+    Guard( const Guard& ) = delete;
+    auto operator=( const Guard& ) -> Guard& = delete;
+
+    int& m_alive;
+};
+
+auto Lookup( int key ) -> Task<std::expected<int, error>> {
+    if( key < 0 ) {
+        co_return std::unexpected( error::miss );
+    }
+    co_return key * 2;
+}
+
+// A lock held across co_await Try( ... ) is released on the error path before the Task
+// awaiting the errored one as an rvalue goes on.
+auto LockReleasedOnError() -> void {
+    AsyncMutex mutex;
+    auto locked = [ & ]( int key ) -> Task<std::expected<int, error>> {
+        auto lock = co_await mutex.Lock();
+        const int value = co_await Try( Lookup( key ) );
+        co_return value + 1;
+    };
+    auto outer = [ & ]() -> Task<bool> {
+        auto result = co_await locked( -1 );
+        CHECK( !result.has_value() && result.error() == error::miss );
+        CHECK( mutex.TryLock() );
+        mutex.Unlock();
+
+        result = co_await locked( 4 );
+        CHECK( result.has_value() && *result == 9 );
+        CHECK( mutex.TryLock() );
+        mutex.Unlock();
+        co_return true;
+    };
+    CHECK( SyncWait( outer() ) );
+}
+
+// Every frame of a Try() chain unwinds before the first Task awaiting without Try() goes on.
+auto ChainUnwinds() -> void {
+    int alive = 0;
+    auto inner = [ & ]() -> Task<std::expected<int, error>> {
+        Guard guard { alive };
+        co_return co_await Try( Lookup( -1 ) );
+    };
+    auto middle = [ & ]() -> Task<std::expected<int, error>> {
+        Guard guard { alive };
+        co_return co_await Try( inner() ) + 1;
+    };
+    auto top = [ & ]() -> Task<std::expected<long, error>> {
+        Guard guard { alive };
+        co_return co_await Try( middle() ) + 1;
+    };
+    auto outer = [ & ]() -> Task<bool> {
+        auto result = co_await top();
+        CHECK( !result.has_value() );
+        CHECK( alive == 0 );
+        co_return true;
+    };
+    CHECK( SyncWait( outer() ) );
+}
+
+// Try() on a Task that already failed releases both frames as well.
+auto AlreadyFailed() -> void {
+    int alive = 0;
+    auto failing = [ & ]() -> Task<std::expected<int, error>> {
+        Guard guard { alive };
+        co_return std::unexpected( error::miss );
+    };
+    auto awaiting = [ & ]() -> Task<std::expected<int, error>> {
+        Guard guard { alive };
+        auto failed = failing();
+        failed.resume();
+        CHECK( failed.is_ready() );
+        co_return co_await Try( std::move( failed ) );
+    };
+    auto outer = [ & ]() -> Task<bool> {
+        auto result = co_await awaiting();
+        CHECK( !result.has_value() && alive == 0 );
+        co_return true;
+    };
+    CHECK( SyncWait( outer() ) );
+}
+
+// Awaited as an lvalue, a Task completed early keeps its frame and result like one that ran
+// to its end: its locals go with the Task object and it can be awaited again.
+auto LvalueAwait() -> void {
+    int alive = 0;
+    AsyncMutex mutex;
+    auto failing = [ & ]() -> Task<std::expected<int, error>> {
+        Guard guard { alive };
+        auto lock = co_await mutex.Lock();
+        co_return co_await Try( Lookup( -1 ) );
+    };
+    auto outer = [ & ]() -> Task<bool> {
+        {
+            auto task = failing();
+            const auto& result = co_await task;
+            CHECK( !result.has_value() && result.error() == error::miss );
+            CHECK( alive == 1 && !mutex.TryLock() );
+
+            const auto& again = co_await task;
+            CHECK( &again == &result && task.promise().Failed() );
+        }
+        CHECK( alive == 0 && mutex.TryLock() );
+        mutex.Unlock();
+        co_return true;
+    };
+    CHECK( SyncWait( outer() ) );
+}
+
+// The errored Task's lock does not stay held until WhenAll completes, which a waiter for the
+// same lock would never let happen.
+auto WhenAllWaiter() -> void {
+    auto tp = std::make_shared<ThreadPool>( [] {
+        ThreadPool::options opts {};
+        opts.thread_count = 2;
+        return opts;
+    }() );
+    AsyncMutex mutex;
+    for( int round = 0; round < 200; ++round ) {
+        auto failing = [ & ]() -> Task<std::expected<int, error>> {
+            co_await tp->Schedule();
+            auto lock = co_await mutex.Lock();
+            co_return co_await Try( Lookup( -1 ) );
+        };
+        auto waiting = [ & ]() -> Task<std::expected<int, error>> {
+            co_await tp->Schedule();
+            auto lock = co_await mutex.Lock();
+            co_return 1;
+        };
+        auto [ failed, waited ] = SyncWait( WhenAll( failing(), waiting() ) );
+        CHECK( !failed.return_value().has_value() );
+        CHECK( waited.return_value().has_value() );
+    }
+}
+
+}
+
+auto main() -> int {
+    LockReleasedOnError();
+    ChainUnwinds();
+    AlreadyFailed();
+    LvalueAwait();
+    WhenAllWaiter();
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "Check.h"
+
+#include <Coroutines/Private/WorkStealingDeque.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Coroutines;
+using namespace Coroutines::Tests;
+
+namespace {
+
+auto OwnerOrder() -> void {
+    Private::WorkStealingDeque<4> deque;
+    std::int64_t stamp = 0;
+    for( std::uintptr_t i = 0; i < 4; ++i ) {
+        CHECK( deque.Push( FakeHandle( i ), static_cast<std::int64_t>( i ) + 10 ) );
+    }
+    CHECK( !deque.Push( FakeHandle( 4 ) ) );
+    CHECK( deque.size() == 4 );
+
+    // The owner pops the newest, thieves take the oldest.
+    CHECK( deque.Pop( stamp ) == FakeHandle( 3 ) && stamp == 13 );
+    CHECK( deque.Steal( stamp ) == FakeHandle( 0 ) && stamp == 10 );
+    CHECK( deque.Steal( stamp ) == FakeHandle( 1 ) );
+    CHECK( deque.Pop( stamp ) == FakeHandle( 2 ) );
+    CHECK( deque.Pop( stamp ) == nullptr );
+    CHECK( deque.Steal( stamp ) == nullptr );
+    CHECK( deque.empty() );
+}
+
+// The owner pushes and pops while thieves steal, every handle must be taken exactly once,
+// including the last one the owner and a thief race for.
+auto StealRace() -> void {
+    constexpr std::uintptr_t HANDLES = 200000;
+    constexpr int THIEVES = 3;
+
+    Private::WorkStealingDeque<64> deque;
+    std::vector<std::atomic<int>> taken( HANDLES );
+    std::atomic<bool> done { false };
+
+    auto take = [ & ]( std::coroutine_handle<> handle ) {
+        CHECK( taken[ FakeIndex( handle ) ].fetch_add( 1, std::memory_order::relaxed ) == 0 );
+    };
+
+    std::vector<std::thread> thieves;
+    for( int i = 0; i < THIEVES; ++i ) {
+        thieves.emplace_back( [ & ] {
+            std::int64_t stamp = 0;
+            while( !done.load( std::memory_order::acquire ) ) {
+                if( auto handle = deque.Steal( stamp ); handle != nullptr ) {
+                    CHECK( static_cast<std::uintptr_t>( stamp ) == FakeIndex( handle ) );
+                    take( handle );
+                }
+            }
+        } );
+    }
+
+    std::int64_t stamp = 0;
+    for( std::uintptr_t i = 0; i < HANDLES; ++i ) {
+        while( !deque.Push( FakeHandle( i ), static_cast<std::int64_t>( i ) ) ) {
+            if( auto handle = deque.Pop( stamp ); handle != nullptr ) {
+                take( handle );
+            }
+        }
+        // Mostly keep one or two handles around so the owner and the thieves meet at the last one.
+        if( i % 3 != 0 ) {
+            if( auto handle = deque.Pop( stamp ); handle != nullptr ) {
+                CHECK( static_cast<std::uintptr_t>( stamp ) == FakeIndex( handle ) );
+                take( handle );
+            }
+        }
+    }
+    while( auto handle = deque.Pop( stamp ) ) {
+        take( handle );
+    }
+
+    done.store( true, std::memory_order::release );
+    for( auto& thief: thieves ) {
+        thief.join();
+    }
+
+    CHECK( deque.empty() );
+    for( auto& count: taken ) {
+        CHECK( count.load() == 1 );
+    }
+}
+
+}
+
+int main() {
+    OwnerOrder();
+    StealRace();
+    return 0;
+}